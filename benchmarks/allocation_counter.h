@@ -0,0 +1,47 @@
+// telekom / sysrepo-plugin-os-metrics
+//
+// This program is made available under the terms of the
+// BSD 3-Clause license which is available at
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// SPDX-FileCopyrightText: 2022 Deutsche Telekom AG
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef ALLOCATION_COUNTER_H
+#define ALLOCATION_COUNTER_H
+
+#include <cstdlib>
+#include <new>
+
+/// @brief Counts the allocations through operator new of the whole program, include it in one
+/// translation unit only.
+inline size_t gAllocations(0);
+
+void* operator new(size_t size) {
+    gAllocations++;
+    if (void* const p = malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+/// @return the mean allocations of a call, f is called the given number of times
+template <typename F>
+double allocationsPerCall(size_t iterations, F&& f) {
+    size_t const before(gAllocations);
+    for (size_t i = 0; i < iterations; i++) {
+        f();
+    }
+    return static_cast<double>(gAllocations - before) / static_cast<double>(iterations);
+}
+
+#endif  // ALLOCATION_COUNTER_H
@@ -0,0 +1,68 @@
+// telekom / sysrepo-plugin-os-metrics
+//
+// This program is made available under the terms of the
+// BSD 3-Clause license which is available at
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// SPDX-FileCopyrightText: 2022 Deutsche Telekom AG
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+/// @brief Call f once to warm up, then the given number of times.
+/// @return the mean wall time of a call in microseconds
+template <typename F>
+double microsecondsPerCall(size_t iterations, F&& f) {
+    f();
+    auto const start(std::chrono::steady_clock::now());
+    for (size_t i = 0; i < iterations; i++) {
+        f();
+    }
+    std::chrono::duration<double, std::micro> const elapsed(std::chrono::steady_clock::now() -
+                                                            start);
+    return elapsed.count() / static_cast<double>(iterations);
+}
+
+inline void report(char const* name, double microseconds) {
+    printf("%-40s %12.2f us\n", name, microseconds);
+}
+
+/// @brief Child processes sleeping while the object lives, for process lists of a given length.
+struct SleepingProcesses {
+    explicit SleepingProcesses(size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            pid_t const child(fork());
+            if (child == 0) {
+                pause();
+                _exit(0);
+            }
+            if (child > 0) {
+                mChildren.push_back(child);
+            }
+        }
+    }
+
+    ~SleepingProcesses() {
+        for (pid_t const child : mChildren) {
+            kill(child, SIGTERM);
+            waitpid(child, nullptr, 0);
+        }
+    }
+
+    SleepingProcesses(SleepingProcesses const&) = delete;
+    void operator=(SleepingProcesses const&) = delete;
+
+private:
+    std::vector<pid_t> mChildren;
+};
+
+#endif  // BENCHMARK_H
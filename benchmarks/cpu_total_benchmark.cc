@@ -0,0 +1,59 @@
+// telekom / sysrepo-plugin-os-metrics
+//
+// This program is made available under the terms of the
+// BSD 3-Clause license which is available at
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// SPDX-FileCopyrightText: 2022 Deutsche Telekom AG
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+// The total CPU time read from /proc/stat for every process of a sweep, as getCpuUsage() did
+// before, against once per sweep.
+
+#include <process_stats.h>
+
+#include <fstream>
+
+#include "benchmark.h"
+
+namespace {
+
+/// @brief The ifstream getCpuTimes() of the time.
+std::optional<size_t> getCpuTimesIfstream() {
+    std::ifstream proc_stat("/proc/stat");
+    proc_stat.ignore(5, ' ');  // Skip the 'cpu' prefix.
+    std::vector<size_t> cpu_times;
+    for (size_t time; proc_stat >> time; cpu_times.push_back(time))
+        ;
+    if (cpu_times.size() < 4)
+        return std::nullopt;
+    return accumulate(cpu_times.begin(), cpu_times.end(), size_t(0));
+}
+
+}  // namespace
+
+int main() {
+    auto& stats(metrics::ProcessStats::getInstance());
+    size_t volatile sink(0);
+    for (size_t const processes : {1000, 10000}) {
+        printf("sweep of %zu processes\n", processes);
+        report("per process, ifstream", microsecondsPerCall(10, [&] {
+                   for (size_t i = 0; i < processes; i++) {
+                       sink = sink + getCpuTimesIfstream().value_or(0);
+                   }
+               }));
+        report("per process, getCpuTimes()", microsecondsPerCall(10, [&] {
+                   for (size_t i = 0; i < processes; i++) {
+                       sink = sink + stats.getCpuTimes().value_or(0);
+                   }
+               }));
+        report("once per sweep, getCpuTimes()", microsecondsPerCall(1000, [&] {
+                   size_t const total(stats.getCpuTimes().value_or(0));
+                   for (size_t i = 0; i < processes; i++) {
+                       sink = sink + total;
+                   }
+               }));
+    }
+    return 0;
+}
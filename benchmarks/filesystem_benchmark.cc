@@ -0,0 +1,85 @@
+// telekom / sysrepo-plugin-os-metrics
+//
+// This program is made available under the terms of the
+// BSD 3-Clause license which is available at
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// SPDX-FileCopyrightText: 2022 Deutsche Telekom AG
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+// Filesystem statistics from df output, as they were read before, against mountinfo and
+// statvfs, uncached and through FilesystemStats.
+
+#include <filesystem_stats.h>
+
+#include <fstream>
+#include <limits>
+
+#include "benchmark.h"
+
+#define DF_OUTPUT_LOCATION "/tmp/os_metrics_benchmark_df1.tmp"
+#define DF_OUTPUT_LOCATION2 "/tmp/os_metrics_benchmark_df2.tmp"
+
+namespace {
+
+using metrics::MountTable;
+
+/// @brief The df pipeline readFilesystemStats() used before.
+size_t readDf() {
+    std::unordered_map<std::string, metrics::Filesystem> fsMap;
+    if (system("/bin/df -T > " DF_OUTPUT_LOCATION "&& /bin/df -i > " DF_OUTPUT_LOCATION2) == -1) {
+        return 0;
+    }
+    std::string token, inodesToken;
+    std::ifstream file(DF_OUTPUT_LOCATION), fileinodes(DF_OUTPUT_LOCATION2);
+    file.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    fileinodes.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    while (file >> token || fileinodes >> inodesToken) {
+        metrics::Filesystem fs;
+        uint64_t inodesTotal;
+        uint64_t inodesUsed;
+        fs.name = token;
+        file >> fs.type >> fs.totalBlocks >> fs.usedBlocks >> fs.availableBlocks >> token >>
+            fs.mountPoint;
+        fileinodes >> token >> inodesTotal >> inodesUsed;
+        struct statvfs buf;
+        if (statvfs(fs.mountPoint.c_str(), &buf) == 0) {
+            fs.populateValues(buf);
+        }
+        fsMap.emplace(fs.mountPoint, fs);
+        file.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        fileinodes.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    }
+    return fsMap.size();
+}
+
+/// @brief mountinfo parsed on every call and one statvfs per mount.
+size_t readMountInfo() {
+    std::unordered_map<std::string, metrics::Filesystem> fsMap;
+    for (auto const& mount : MountTable::readMountInfo()) {
+        struct statvfs buf;
+        if (statvfs(mount.mountPoint.c_str(), &buf) != 0 || buf.f_blocks == 0) {
+            continue;
+        }
+        metrics::Filesystem fs;
+        fs.name = mount.device;
+        fs.type = mount.type;
+        fs.mountPoint = mount.mountPoint;
+        fs.populateValues(buf);
+        fsMap.insert_or_assign(mount.mountPoint, fs);
+    }
+    return fsMap.size();
+}
+
+}  // namespace
+
+int main() {
+    printf("mount points: df %zu, mountinfo %zu\n", readDf(), readMountInfo());
+    report("df -T and df -i", microsecondsPerCall(200, readDf));
+    report("mountinfo and statvfs", microsecondsPerCall(2000, readMountInfo));
+    report("FilesystemStats::readFilesystemStats", microsecondsPerCall(2000, [] {
+               metrics::FilesystemStats::getInstance().readFilesystemStats();
+           }));
+    return 0;
+}
@@ -0,0 +1,182 @@
+// telekom / sysrepo-plugin-os-metrics
+//
+// This program is made available under the terms of the
+// BSD 3-Clause license which is available at
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// SPDX-FileCopyrightText: 2022 Deutsche Telekom AG
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+// The "Key: value" parsers of /proc/<pid>/status, io and /proc/meminfo used before, with an
+// unordered_map of std::function per key, against the sorted KeyValueParser tables. Time and
+// allocations per call, and whether both parsed the same values.
+
+#include <memory_stats.h>
+#include <process_stats.h>
+
+#include <fstream>
+#include <functional>
+#include <unordered_map>
+
+#include "allocation_counter.h"
+#include "benchmark.h"
+
+namespace {
+
+using metrics::ProcessSample;
+
+using setFunction_t = const std::function<void(uint64_t, ProcessSample&)>;
+
+/// @brief The previous ProcessStats::getSetFunction().
+setFunction_t getSetFunction(std::string const& token) {
+    static std::unordered_map<std::string, setFunction_t> _{
+        {"syscr:", [](uint64_t value, ProcessSample& sample) { sample.readCount = value; }},
+        {"syscw:", [](uint64_t value, ProcessSample& sample) { sample.writeCount = value; }},
+        {"read_bytes:", [](uint64_t value, ProcessSample& sample) { sample.readBytes = value; }},
+        {"write_bytes:",
+         [](uint64_t value, ProcessSample& sample) { sample.writeBytes = value; }},
+        {"VmSize:", [](uint64_t value, ProcessSample& sample) { sample.vmSize = value; }},
+        {"VmRSS:", [](uint64_t value, ProcessSample& sample) { sample.vmRss = value; }},
+        {"RssFile:", [](uint64_t value, ProcessSample& sample) { sample.rssFile = value; }},
+        {"RssShmem:", [](uint64_t value, ProcessSample& sample) { sample.rssShmem = value; }},
+        {"voluntary_ctxt_switches:",
+         [](uint64_t value, ProcessSample& sample) { sample.voluntaryCtxSwitches = value; }},
+        {"nonvoluntary_ctxt_switches:",
+         [](uint64_t value, ProcessSample& sample) { sample.involuntaryCtxSwitches = value; }},
+        {"FDSize:", [](uint64_t value, ProcessSample& sample) { sample.fdSize = value; }}};
+    if (_.find(token) != _.end()) {
+        return _.at(token);
+    }
+    return nullptr;
+}
+
+/// @brief The previous ProcessStats::parse().
+void parseWithMap(std::string_view content, ProcessSample& sample) {
+    while (!content.empty()) {
+        size_t const eol = std::min(content.find('\n'), content.size());
+        std::string_view const line(content.substr(0, eol));
+        content.remove_prefix(std::min(eol + 1, content.size()));
+        size_t const colon = line.find(':');
+        if (colon == std::string_view::npos) {
+            continue;
+        }
+        auto const& func = getSetFunction(std::string(line.substr(0, colon + 1)));
+        if (!func) {
+            continue;
+        }
+        size_t const begin = line.find_first_not_of(" \t", colon + 1);
+        if (begin == std::string_view::npos) {
+            continue;
+        }
+        uint64_t value;
+        if (std::from_chars(line.data() + begin, line.data() + line.size(), value).ec ==
+            std::errc()) {
+            func(value, sample);
+        }
+    }
+}
+
+/// @brief The previous MemoryStats::readMemoryStats(), for the fields it stored.
+struct MapMemoryStats {
+    MapMemoryStats() {
+        assignMap = {{"MemTotal:", [this](uint64_t value) { mTotal = value; }},
+                     {"MemFree:", [this](uint64_t value) { mFree = value; }},
+                     {"MemAvailable:", [this](uint64_t value) { mUsable = value; }},
+                     {"SwapTotal:", [this](uint64_t value) { mSwapTotal = value; }},
+                     {"SwapFree:", [this](uint64_t value) { mSwapFree = value; }},
+                     {"Shmem:", [this](uint64_t value) { mUsedShared = value; }},
+                     {"Cached:", [this](uint64_t value) { mUsedCached = value; }},
+                     {"Buffers:", [this](uint64_t value) { mUsedBuffers = value; }},
+                     {"HugePages_Total:", [this](uint64_t value) { mHugePagesTotal = value; }},
+                     {"HugePages_Free:", [this](uint64_t value) { mHugePagesFree = value; }},
+                     {"Hugepagesize:", [this](uint64_t value) { mHugePageSize = value; }}};
+    }
+
+    void readMemoryStats() {
+        std::string token;
+        std::ifstream file("/proc/meminfo");
+        while (file >> token) {
+            auto const& itr = assignMap.find(token);
+            if (itr != assignMap.end()) {
+                uint64_t mem;
+                if (file >> mem) {
+                    assignMap[token](mem);
+                }
+            }
+            // ignore rest of the line
+            file.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        }
+    }
+
+    std::unordered_map<std::string, std::function<void(uint64_t)>> assignMap;
+    uint64_t mFree = 0;
+    uint64_t mSwapFree = 0;
+    uint64_t mSwapTotal = 0;
+    uint64_t mTotal = 0;
+    uint64_t mUsable = 0;
+    uint64_t mUsedBuffers = 0;
+    uint64_t mUsedCached = 0;
+    uint64_t mUsedShared = 0;
+    uint64_t mHugePagesTotal = 0;
+    uint64_t mHugePagesFree = 0;
+    uint64_t mHugePageSize = 0;
+};
+
+std::string readFile(char const* path) {
+    std::ifstream file(path);
+    return std::string(std::istreambuf_iterator<char>(file), {});
+}
+
+bool sameSample(ProcessSample const& a, ProcessSample const& b) {
+    return a.vmSize == b.vmSize && a.vmRss == b.vmRss && a.rssFile == b.rssFile &&
+           a.rssShmem == b.rssShmem && a.fdSize == b.fdSize &&
+           a.voluntaryCtxSwitches == b.voluntaryCtxSwitches &&
+           a.involuntaryCtxSwitches == b.involuntaryCtxSwitches &&
+           a.readCount == b.readCount && a.writeCount == b.writeCount &&
+           a.readBytes == b.readBytes && a.writeBytes == b.writeBytes;
+}
+
+}  // namespace
+
+int main() {
+    std::string const status(readFile("/proc/self/status"));
+    std::string const io(readFile("/proc/self/io"));
+    ProcessSample before, after;
+    auto const parseBefore = [&] {
+        parseWithMap(status, before);
+        parseWithMap(io, before);
+    };
+    auto const parseAfter = [&] {
+        metrics::ProcessStats::parse(status, after);
+        metrics::ProcessStats::parse(io, after);
+    };
+    parseBefore();
+    parseAfter();
+    printf("status and io, same fields: %s\n", sameSample(before, after) ? "yes" : "no");
+    report("unordered_map of std::function", microsecondsPerCall(100000, parseBefore));
+    printf("%-40s %12.1f\n", "  allocations", allocationsPerCall(100, parseBefore));
+    report("KeyValueParser", microsecondsPerCall(100000, parseAfter));
+    printf("%-40s %12.1f\n", "  allocations", allocationsPerCall(100, parseAfter));
+
+    MapMemoryStats memoryBefore;
+    auto& memoryAfter(metrics::MemoryStats::getInstance());
+    memoryBefore.readMemoryStats();
+    memoryAfter.readMemoryStats();
+    bool const same(memoryBefore.mTotal == memoryAfter.mTotal &&
+                    memoryBefore.mUsable == memoryAfter.mUsable &&
+                    memoryBefore.mSwapFree == memoryAfter.mSwapFree &&
+                    memoryBefore.mHugePageSize == memoryAfter.mHugePageSize);
+    printf("/proc/meminfo, same fields: %s\n", same ? "yes" : "no");
+    report("ifstream and unordered_map", microsecondsPerCall(20000, [&] {
+               memoryBefore.readMemoryStats();
+           }));
+    printf("%-40s %12.1f\n", "  allocations",
+           allocationsPerCall(100, [&] { memoryBefore.readMemoryStats(); }));
+    report("ProcFileReader and KeyValueParser", microsecondsPerCall(20000, [&] {
+               memoryAfter.readMemoryStats();
+           }));
+    printf("%-40s %12.1f\n", "  allocations",
+           allocationsPerCall(100, [&] { memoryAfter.readMemoryStats(); }));
+    return 0;
+}
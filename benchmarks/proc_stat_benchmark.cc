@@ -0,0 +1,88 @@
+// telekom / sysrepo-plugin-os-metrics
+//
+// This program is made available under the terms of the
+// BSD 3-Clause license which is available at
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// SPDX-FileCopyrightText: 2022 Deutsche Telekom AG
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+// The ifstream parser of /proc/stat used before against CpuStats::readCpuTimes() with a
+// ProcFileReader, time and allocations per read, and where the totals of the cores differ.
+// Usage: proc_stat_benchmark [file, default /proc/stat]
+
+#include <cpu_stats.h>
+
+#include <fstream>
+#include <sstream>
+
+#include "allocation_counter.h"
+#include "benchmark.h"
+
+namespace {
+
+/// @brief The previous CpuStats::readCpuTimes(), with the path as a parameter.
+struct IfstreamCpuStats {
+    static size_t total(std::vector<size_t> const& cpu_times) {
+        return std::accumulate(cpu_times.begin(), cpu_times.end(), size_t(0));
+    }
+
+    void readCpuTimes(char const* path) {
+        std::ifstream proc_stat(path);
+        std::string line;
+        std::vector<size_t> cpu_times;
+        std::getline(proc_stat, line);
+        std::istringstream stream(line);
+        stream.ignore(5, ' ');  // ignore cpu keyword
+        for (size_t time; stream >> time; cpu_times.push_back(time))
+            ;
+        mTotal = total(cpu_times);
+
+        std::getline(proc_stat, line);
+        while (std::string(line).find("cpu") != std::string::npos) {
+            stream = std::istringstream(line);
+            stream.ignore(5, ' ');  // ignore cpu keyword
+            std::vector<size_t> cpu_times;
+            for (size_t time; stream >> time; cpu_times.push_back(time))
+                ;
+            mCoreTotals.emplace_back(total(cpu_times));
+            std::getline(proc_stat, line);
+        }
+    }
+
+    size_t mTotal = 0;
+    std::vector<size_t> mCoreTotals;
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    char const* const path(argc > 1 ? argv[1] : metrics::CpuStats::kLocation);
+
+    IfstreamCpuStats before;
+    before.readCpuTimes(path);
+    metrics::ProcFileReader reader(path);
+    metrics::CpuStats after;
+    after.readCpuTimes(reader);
+    printf("%s: %zu cores, ifstream %zu cores\n", path, after.mCores.size(),
+           before.mCoreTotals.size());
+    // the ifstream parser skips only 5 characters of "cpuN", from cpu100 on it reads the last
+    // digit of the id as the first time
+    for (size_t core = 0; core < std::min(before.mCoreTotals.size(), after.mCores.size());
+         core++) {
+        if (static_cast<double>(before.mCoreTotals[core]) != after.mCores.total()[core]) {
+            printf("  totals differ from core %zu on\n", core);
+            break;
+        }
+    }
+
+    report("ifstream", microsecondsPerCall(2000, [&] { IfstreamCpuStats().readCpuTimes(path); }));
+    printf("%-40s %12.1f\n", "  allocations", allocationsPerCall(100, [&] {
+               IfstreamCpuStats().readCpuTimes(path);
+           }));
+    report("ProcFileReader", microsecondsPerCall(2000, [&] { after.readCpuTimes(reader); }));
+    printf("%-40s %12.1f\n", "  allocations",
+           allocationsPerCall(100, [&] { after.readCpuTimes(reader); }));
+    return 0;
+}
@@ -0,0 +1,53 @@
+// telekom / sysrepo-plugin-os-metrics
+//
+// This program is made available under the terms of the
+// BSD 3-Clause license which is available at
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// SPDX-FileCopyrightText: 2022 Deutsche Telekom AG
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+// A process sweep with plain reads, with an io_uring reader set up for every sweep, and with
+// the pooled readers collect() takes. Only built with liburing.
+// Usage: uring_benchmark [extra processes]
+
+#include <process_stats.h>
+
+#include "benchmark.h"
+
+int main(int argc, char** argv) {
+    using metrics::ProcessStats;
+    SleepingProcesses const extra(argc > 1 ? std::stoul(argv[1]) : 0);
+    auto& stats(ProcessStats::getInstance());
+    auto const pids(ProcessStats::listPids());
+    printf("%zu processes\n", pids.size());
+
+    std::vector<metrics::ProcessSample> samples;
+    report("plain reads", microsecondsPerCall(30, [&] {
+               samples.clear();
+               metrics::ProcReader reader;
+               for (int32_t const pid : pids) {
+                   metrics::ProcessSample sample;
+                   sample.pid = pid;
+                   if (ProcessStats::read(reader, sample)) {
+                       samples.push_back(std::move(sample));
+                   }
+               }
+           }));
+    report("io_uring reader per sweep", microsecondsPerCall(30, [&] {
+               samples.clear();
+               metrics::ProcReader reader;
+               metrics::UringProcReader uring;
+               for (size_t i = 0; i < pids.size(); i += metrics::UringProcReader::kBatchSize) {
+                   size_t const count(
+                       std::min<size_t>(pids.size() - i, metrics::UringProcReader::kBatchSize));
+                   ProcessStats::readBatch(uring, reader, &pids[i], count, samples);
+               }
+           }));
+    report("pooled io_uring reader", microsecondsPerCall(30, [&] {
+               samples.clear();
+               stats.collect(pids.begin(), pids.end(), samples);
+           }));
+    return 0;
+}
@@ -0,0 +1,45 @@
+// telekom / sysrepo-plugin-os-metrics
+//
+// This program is made available under the terms of the
+// BSD 3-Clause license which is available at
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// SPDX-FileCopyrightText: 2022 Deutsche Telekom AG
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+// Process collection with 1 to N worker threads over the processes of this host, and the
+// cost of a shard of kMinShardSize processes next to starting and joining a thread for it.
+// Usage: worker_scaling_benchmark [max workers] [extra processes]
+// The default is twice the online CPUs. Extra processes are forked to sleep during the run,
+// collectAll() only splits lists of at least two shards.
+
+#include <process_stats.h>
+
+#include "benchmark.h"
+
+int main(int argc, char** argv) {
+    uint32_t const maxWorkers(argc > 1 ? static_cast<uint32_t>(std::stoul(argv[1]))
+                                       : std::max(2u, 2 * std::thread::hardware_concurrency()));
+    // forked before the plugin starts any threads
+    SleepingProcesses const extra(argc > 2 ? std::stoul(argv[2]) : 0);
+    auto& stats(metrics::ProcessStats::getInstance());
+    auto const pids(metrics::ProcessStats::listPids());
+    printf("%zu processes, %u online CPUs\n", pids.size(), std::thread::hardware_concurrency());
+
+    char name[64];
+    for (uint32_t workers = 1; workers <= maxWorkers; workers++) {
+        stats.setWorkerThreads(workers);
+        snprintf(name, sizeof(name), "collectAll, %u worker threads", workers);
+        report(name, microsecondsPerCall(30, [&] { stats.collectAll(pids); }));
+    }
+
+    // a shard is only worth a thread of its own if collecting it costs well above this
+    report("start and join a thread", microsecondsPerCall(1000, [] { std::thread([] {}).join(); }));
+    std::vector<int32_t> const shard(pids.begin(),
+                                     pids.begin() + std::min<size_t>(64, pids.size()));
+    stats.setWorkerThreads(1);
+    snprintf(name, sizeof(name), "collectAll, one shard of %zu", shard.size());
+    report(name, microsecondsPerCall(100, [&] { stats.collectAll(shard); }));
+    return 0;
+}
@@ -11,6 +11,7 @@
 #ifndef CALLBACK_H
 #define CALLBACK_H
 
+#include <cpu_sampler.h>
 #include <cpu_stats.h>
 #include <filesystem_stats.h>
 #include <memory_stats.h>
@@ -32,26 +33,14 @@ struct Callback {
                                       std::optional<std::string_view> /* requestXPath */,
                                       uint32_t /* requestId */,
                                       std::optional<DataNode>& parent) {
-        CpuStats stats;
-        stats.readCpuTimes();
-        stats.setXpathValues(session, parent, moduleName);
-        double loadavg[3];
-        if (getloadavg(loadavg, 3) != -1) {
-            setXpath(session, parent,
-                     "/" + std::string(moduleName) +
-                         ":system-metrics/cpu-statistics/average-load/avg-1min-load",
-                     std::to_string(loadavg[0]));
-            setXpath(session, parent,
-                     "/" + std::string(moduleName) +
-                         ":system-metrics/cpu-statistics/average-load/avg-5min-load",
-                     std::to_string(loadavg[1]));
-            setXpath(session, parent,
-                     "/" + std::string(moduleName) +
-                         ":system-metrics/cpu-statistics/average-load/avg-15min-load",
-                     std::to_string(loadavg[2]));
-        } else {
-            logMessage(SR_LL_ERR, "getloadavg call failed");
+        auto stats(CpuSampler::getInstance().utilization());
+        if (!stats) {
+            // no interval sampled yet, report the times since boot
+            stats.emplace();
+            stats.value().readCpuTimes();
         }
+        stats.value().setXpathValues(session, parent, moduleName);
+        CpuStats::setLoadAverageXpathValues(session, parent, moduleName);
         return ErrorCode::Ok;
     }
 
@@ -71,6 +60,23 @@ struct Callback {
         return ErrorCode::Ok;
     }
 
+    static ErrorCode memoryNotificationQueueCallback(
+        Session session,
+        uint32_t /* subscriptionId */,
+        std::string_view moduleName,
+        std::optional<std::string_view> /* subXPath */,
+        std::optional<std::string_view> /* requestXPath */,
+        uint32_t /* requestId */,
+        std::optional<DataNode>& parent) {
+        auto module = findModule(session, moduleName);
+        if (module && module.value().featureEnabled("usage-notifications")) {
+            MemoryMonitoring::getInstance().setNotificationQueueXpaths(
+                session, parent,
+                "/" + std::string(moduleName) + ":system-metrics/memory/notification-queue");
+        }
+        return ErrorCode::Ok;
+    }
+
     static ErrorCode filesystemStateCallback(Session session,
                                              uint32_t /* subscriptionId */,
                                              std::string_view moduleName,
@@ -91,10 +97,12 @@ struct Callback {
                                             uint32_t /* subscriptionId */,
                                             std::string_view moduleName,
                                             std::optional<std::string_view> /* subXPath */,
-                                            std::optional<std::string_view> /* requestXPath */,
+                                            std::optional<std::string_view> requestXPath,
                                             uint32_t /* requestId */,
                                             std::optional<DataNode>& parent) {
-        ProcessStats::getInstance().readAndSetAll(session, parent, moduleName);
+        XpathArena arena;
+        ProcessStats::getInstance().readAndSetAll(session, parent, moduleName, requestXPath,
+                                                  arena);
         return ErrorCode::Ok;
     }
 
@@ -107,15 +115,94 @@ struct Callback {
         printCurrentConfig(session, moduleName, "system-metrics/memory//*");
         auto module = findModule(session, moduleName);
         if (module && module.value().featureEnabled("usage-notifications")) {
-            MemoryMonitoring::getInstance().notifyAndJoin();
-            MemoryMonitoring::getInstance().populateConfigData(session, moduleName);
-            MemoryMonitoring::getInstance().startThread();
+            MemoryMonitoring::getInstance().applyChanges(session, moduleName);
         } else {
             logMessage(SR_LL_WRN, "Feature not enabled: usage-notifications");
         }
         return ErrorCode::Ok;
     }
 
+    static ErrorCode processesConfigCallback(Session session,
+                                             uint32_t /* subscriptionId */,
+                                             std::string_view moduleName,
+                                             std::optional<std::string_view> /* subXPath */,
+                                             Event /* event */,
+                                             uint32_t /* request_id */) {
+        printCurrentConfig(session, moduleName, "system-metrics/processes/collection//*");
+        std::string const collectionPath("/" + std::string(moduleName) +
+                                         ":system-metrics/processes/collection");
+        uint32_t workerThreads(1);
+        uint32_t topN(0);
+        ProcessStats::SortKey sortKey(ProcessStats::SortKey::Cpu);
+        auto const& data(session.getData(collectionPath));
+        if (data) {
+            auto const& node(data.value().findPath(collectionPath + "/worker-threads"));
+            if (node) {
+                workerThreads = std::get<uint32_t>(node.value().asTerm().value());
+            }
+            auto const& topNNode(data.value().findPath(collectionPath + "/top-n"));
+            if (topNNode) {
+                topN = std::get<uint32_t>(topNNode.value().asTerm().value());
+            }
+            auto const& sortKeyNode(data.value().findPath(collectionPath + "/sort-key"));
+            if (sortKeyNode) {
+                sortKey = ProcessStats::sortKeyFromString(
+                              std::get<libyang::Enum>(sortKeyNode.value().asTerm().value()).name)
+                              .value_or(ProcessStats::SortKey::Cpu);
+            }
+        }
+        ProcessStats::getInstance().setWorkerThreads(workerThreads);
+        ProcessStats::getInstance().setTopN(topN, sortKey);
+        return ErrorCode::Ok;
+    }
+
+    static ErrorCode loggingConfigCallback(Session session,
+                                           uint32_t /* subscriptionId */,
+                                           std::string_view moduleName,
+                                           std::optional<std::string_view> /* subXPath */,
+                                           Event /* event */,
+                                           uint32_t /* request_id */) {
+        std::string const levelPath("/" + std::string(moduleName) +
+                                    ":system-metrics/logging/level");
+        std::optional<sr_log_level_t> level;
+        auto const& data(session.getData(levelPath));
+        if (data) {
+            auto const& node(data.value().findPath(levelPath));
+            if (node) {
+                std::string_view const name(
+                    std::get<libyang::Enum>(node.value().asTerm().value()).name);
+                level = name == "error"     ? SR_LL_ERR
+                        : name == "warning" ? SR_LL_WRN
+                        : name == "info"    ? SR_LL_INF
+                                            : SR_LL_DBG;
+            }
+        }
+        setLogLevel(level);
+        printCurrentConfig(session, moduleName, "system-metrics/logging//*");
+        return ErrorCode::Ok;
+    }
+
+    static ErrorCode cpuSamplingConfigCallback(Session session,
+                                               uint32_t /* subscriptionId */,
+                                               std::string_view moduleName,
+                                               std::optional<std::string_view> /* subXPath */,
+                                               Event /* event */,
+                                               uint32_t /* request_id */) {
+        printCurrentConfig(session, moduleName, "system-metrics/cpu-sampling//*");
+        std::string const intervalPath("/" + std::string(moduleName) +
+                                       ":system-metrics/cpu-sampling/interval");
+        uint32_t interval(1000);
+        auto const& data(session.getData(intervalPath));
+        if (data) {
+            auto const& node(data.value().findPath(intervalPath));
+            if (node) {
+                interval = std::get<uint32_t>(node.value().asTerm().value());
+            }
+        }
+        CpuSampler::getInstance().setInterval(std::chrono::milliseconds(interval));
+        return ErrorCode::Ok;
+    }
+
     static ErrorCode filesystemsConfigCallback(Session session,
                                                uint32_t /* subscriptionId */,
                                                std::string_view moduleName,
@@ -125,9 +212,7 @@ struct Callback {
         printCurrentConfig(session, moduleName, "system-metrics/filesystems//*");
         auto module = findModule(session, moduleName);
         if (module && module.value().featureEnabled("usage-notifications")) {
-            FilesystemMonitoring::getInstance().notifyAndJoin();
-            FilesystemMonitoring::getInstance().populateConfigData(session, moduleName);
-            FilesystemMonitoring::getInstance().startThreads();
+            FilesystemMonitoring::getInstance().applyChanges(session, moduleName);
         } else {
             logMessage(SR_LL_WRN, "Feature not enabled: usage-notifications");
         }
@@ -0,0 +1,144 @@
+// telekom / sysrepo-plugin-os-metrics
+//
+// This program is made available under the terms of the
+// BSD 3-Clause license which is available at
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// SPDX-FileCopyrightText: 2022 Deutsche Telekom AG
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef CPU_SAMPLE_CACHE_H
+#define CPU_SAMPLE_CACHE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace metrics {
+
+/// @brief Previous cpu time samples of processes, used to compute the cpu usage between two
+/// sweeps. Keyed by (pid, start time) so a reused pid never inherits a stale sample, stored in
+/// a linear probing table. Entries not seen during the last sweep are evicted at its end, so the
+/// size stays proportional to the number of live processes.
+struct CpuSampleCache {
+    struct Sample {
+        size_t totalTime;
+        size_t utime;
+        size_t stime;
+    };
+
+    CpuSampleCache() : mSlots(kMinCapacity), mSize(0), mGeneration(1){};
+
+    void beginSweep() {
+        mGeneration++;
+    }
+
+    /// @brief Drop every entry that was not looked up since beginSweep().
+    void endSweep() {
+        size_t live(0);
+        for (auto const& slot : mSlots) {
+            live += slot.pid != 0 && slot.generation == mGeneration;
+        }
+        rehash(capacityFor(live), [this](Slot const& slot) {
+            return slot.generation == mGeneration;
+        });
+    }
+
+    /// @brief Drop the entries of the given processes, e.g. after they exited.
+    void evict(std::vector<int32_t> pids) {
+        if (pids.empty()) {
+            return;
+        }
+        std::sort(pids.begin(), pids.end());
+        rehash(mSlots.size(), [&pids](Slot const& slot) {
+            return !std::binary_search(pids.begin(), pids.end(), slot.pid);
+        });
+    }
+
+    /// @brief Store the new sample of a process.
+    /// @return the sample stored by the previous sweep, if any
+    std::optional<Sample> exchange(int32_t pid, uint64_t startTime, Sample const& sample) {
+        if ((mSize + 1) * 10 > mSlots.size() * 7) {
+            rehash(mSlots.size() * 2, [](Slot const&) { return true; });
+        }
+        Slot& slot = find(pid, startTime);
+        std::optional<Sample> previous;
+        if (slot.pid == 0) {
+            slot.pid = pid;
+            slot.startTime = startTime;
+            mSize++;
+        } else {
+            previous = slot.sample;
+        }
+        slot.sample = sample;
+        slot.generation = mGeneration;
+        return previous;
+    }
+
+    size_t size() const {
+        return mSize;
+    }
+
+private:
+    static constexpr size_t kMinCapacity = 64;
+
+    struct Slot {
+        int32_t pid = 0;  // 0 marks an empty slot, pid 0 is never a process
+        uint32_t generation = 0;
+        uint64_t startTime = 0;
+        Sample sample = {0, 0, 0};
+    };
+
+    static size_t capacityFor(size_t entries) {
+        size_t capacity(kMinCapacity);
+        while (entries * 10 > capacity * 7) {
+            capacity *= 2;
+        }
+        return capacity;
+    }
+
+    static size_t hash(int32_t pid, uint64_t startTime) {
+        // splitmix64 finalizer
+        uint64_t x = (static_cast<uint64_t>(pid) << 32) ^ startTime;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+
+    /// @brief Slot holding the key, or the empty slot it would be inserted at.
+    Slot& find(int32_t pid, uint64_t startTime) {
+        size_t const mask = mSlots.size() - 1;
+        for (size_t i = hash(pid, startTime) & mask;; i = (i + 1) & mask) {
+            Slot& slot = mSlots[i];
+            if (slot.pid == 0 || (slot.pid == pid && slot.startTime == startTime)) {
+                return slot;
+            }
+        }
+    }
+
+    /// @brief Rebuild the table with the given capacity, keeping the entries keep() accepts.
+    template <typename F>
+    void rehash(size_t capacity, F&& keep) {
+        std::vector<Slot> slots(capacity);
+        slots.swap(mSlots);
+        mSize = 0;
+        for (auto const& slot : slots) {
+            if (slot.pid == 0 || !keep(slot)) {
+                continue;
+            }
+            find(slot.pid, slot.startTime) = slot;
+            mSize++;
+        }
+    }
+
+    std::vector<Slot> mSlots;  // capacity is a power of two
+    size_t mSize;
+    uint32_t mGeneration;
+};
+
+}  // namespace metrics
+
+#endif  // CPU_SAMPLE_CACHE_H
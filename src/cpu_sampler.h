@@ -0,0 +1,95 @@
+// telekom / sysrepo-plugin-os-metrics
+//
+// This program is made available under the terms of the
+// BSD 3-Clause license which is available at
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// SPDX-FileCopyrightText: 2022 Deutsche Telekom AG
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef CPU_SAMPLER_H
+#define CPU_SAMPLER_H
+
+#include <cpu_stats.h>
+#include <scheduler.h>
+#include <utils/globals.h>
+
+#include <array>
+#include <chrono>
+#include <mutex>
+#include <optional>
+
+namespace metrics {
+
+/// @brief Samples the cpu times on a scheduler thread of its own into a ring of the last
+/// samples, so the cpu statistics are served as utilization over the last interval without
+/// reading procfs. The threshold checks can block on hung mounts, on their thread the samples
+/// would be taken late and skew the utilization.
+struct CpuSampler {
+    static constexpr char const* kSchedulerKey = "cpu-sampling";
+
+    static CpuSampler& getInstance() {
+        static CpuSampler instance;
+        return instance;
+    }
+
+    CpuSampler(CpuSampler const&) = delete;
+    void operator=(CpuSampler const&) = delete;
+
+    void setInterval(std::chrono::milliseconds interval) {
+        logMessage(SR_LL_DBG, "CPU sampling interval: ", interval.count(), "ms");
+        {
+            std::lock_guard lk(mMtx);
+            if (mCount == 0) {
+                // start the first interval right away
+                sampleLocked();
+            }
+        }
+        mScheduler.schedule(kSchedulerKey, interval, [this] { sample(); });
+    }
+
+    /// @brief Stop sampling on plugin cleanup, a running sample is waited for.
+    void stop() {
+        mScheduler.cancel(kSchedulerKey);
+    }
+
+    void sample() {
+        std::lock_guard lk(mMtx);
+        sampleLocked();
+    }
+
+    /// @return utilization between the last two samples, nullopt until the first interval
+    /// has passed
+    std::optional<CpuStats> utilization() {
+        std::lock_guard lk(mMtx);
+        if (mCount < 2) {
+            return std::nullopt;
+        }
+        return mRing[(mCount - 1) % kRingSize].since(mRing[(mCount - 2) % kRingSize]);
+    }
+
+private:
+    // one slot more than utilization() needs, so a failed read cannot clobber either sample
+    static constexpr size_t kRingSize = 3;
+
+    CpuSampler() : mReader(CpuStats::kLocation), mCount(0){};
+
+    /// @brief Parse into the oldest slot in place, which reuses its per-core arrays.
+    void sampleLocked() {
+        if (mRing[mCount % kRingSize].readCpuTimes(mReader)) {
+            mCount++;
+        }
+    }
+
+    std::mutex mMtx;
+    ProcFileReader mReader;
+    std::array<CpuStats, kRingSize> mRing;
+    uint64_t mCount;
+    // last, its thread is stopped before the samples are destroyed
+    Scheduler mScheduler;
+};
+
+}  // namespace metrics
+
+#endif  // CPU_SAMPLER_H
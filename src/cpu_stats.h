@@ -11,149 +11,424 @@
 #ifndef CPU_STATS_H
 #define CPU_STATS_H
 
+#include <cpu_topology.h>
+#include <proc_reader.h>
 #include <utils/globals.h>
+#include <xpath_cache.h>
 
-#include <fstream>
-#include <iomanip>
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstdlib>
 #include <iostream>
+#include <map>
+#include <mutex>
 #include <numeric>
 #include <optional>
-#include <sstream>
+#include <string_view>
 #include <vector>
 
 namespace metrics {
 
+/// @brief The times of a cpu line of /proc/stat that are reported, in the order of the line.
+enum CpuState : size_t { User = 0, Nice, System, Idle, Iowait, Irq, Softirq, Stolen, kCpuStates };
+
+/// @brief The cpu-times leaf of each CpuState.
+static constexpr char const* kCpuStateLeaves[kCpuStates] = {
+    "user", "nice", "sys", "idle", "wait", "irq", "softirq", "stolen"};
+
+using CpuStateTimes = std::array<double, kCpuStates>;
+
+[[maybe_unused]] static void setCpuTimesXpath(lyd_node* node, CpuStateTimes const& percent) {
+    for (size_t state = 0; state < kCpuStates; state++) {
+        setPercentXpath(node, kCpuStateLeaves[state], percent[state]);
+    }
+}
+
 struct CoreStats {
+    /// @brief user, nice, system, idle, iowait, irq, softirq, steal, guest and guest_nice
+    static constexpr size_t kFieldCount = 10;
+    using Times = std::array<size_t, kFieldCount>;
 
-    CoreStats()
-        : mUser(0), mNice(0), mSystem(0), mIdle(0), mIowait(0), mIrq(0), mSoftirq(0), mStolen(0),
-          mTotal(1){};
+    CoreStats() : mTotal(0) {
+        mTimes.fill(0);
+    };
 
-    CoreStats(std::vector<size_t> const& cpu_times) {
-        populateValues(cpu_times);
+    /// @brief Split the next line off the content if it is a cpu line of /proc/stat.
+    /// @param core set to N for a "cpuN" line, to nullopt for the aggregate "cpu" line
+    /// @param times the times of the line, missing ones are zero
+    /// @return the number of times on the line, 0 if it is not a cpu line
+    static size_t
+    parseLine(std::string_view& content, std::optional<uint32_t>& core, Times& times) {
+        size_t const end(std::min(content.find('\n'), content.size()));
+        std::string_view line(content.substr(0, end));
+        content.remove_prefix(std::min(end + 1, content.size()));
+        if (line.substr(0, 3) != "cpu") {
+            return 0;
+        }
+        char const* position(line.data() + 3);
+        char const* const last(line.data() + line.size());
+        core = std::nullopt;
+        if (position != last && *position != ' ') {
+            uint32_t id;
+            auto const result = std::from_chars(position, last, id);
+            if (result.ec != std::errc()) {
+                return 0;
+            }
+            core = id;
+            position = result.ptr;
+        }
+        times.fill(0);
+        size_t count(0);
+        while (count < kFieldCount) {
+            while (position != last && *position == ' ') {
+                position++;
+            }
+            auto const result = std::from_chars(position, last, times[count]);
+            if (result.ec != std::errc()) {
+                break;
+            }
+            position = result.ptr;
+            count++;
+        }
+        return count;
     }
 
     void printValues() const {
-        std::cout << mUser << " " << mUser << " " << mSystem << " " << mIdle << " " << mIowait
-                  << " " << mIrq << " " << mSoftirq << " " << mStolen << " " << mTotal << std::endl;
+        for (double time : mTimes) {
+            std::cout << time << " ";
+        }
+        std::cout << mTotal << std::endl;
     }
 
     void setXpathValues(sysrepo::Session session,
                         std::optional<libyang::DataNode>& parent,
-                        std::string_view moduleName,
-                        std::optional<size_t> index) {
-        std::string basePath("/" + std::string(moduleName) + ":system-metrics/cpu-statistics");
-        std::string cpuPath;
-        if (index) {
-            cpuPath = "/cpu[id='" + std::to_string(index.value()) + "']";
-        }
-        std::stringstream stream;
-        stream << std::fixed << std::setprecision(2)
-               << mUser / static_cast<long double>(mTotal) * 100.0;
-        setXpath(session, parent, basePath + cpuPath + "/user", stream.str());
-        stream = std::stringstream();
-        stream << std::fixed << std::setprecision(2)
-               << mSystem / static_cast<long double>(mTotal) * 100.0;
-        setXpath(session, parent, basePath + cpuPath + "/sys", stream.str());
-        stream = std::stringstream();
-        stream << std::fixed << std::setprecision(2)
-               << mNice / static_cast<long double>(mTotal) * 100.0;
-        setXpath(session, parent, basePath + cpuPath + "/nice", stream.str());
-        stream = std::stringstream();
-        stream << std::fixed << std::setprecision(2)
-               << mIdle / static_cast<long double>(mTotal) * 100.0;
-        setXpath(session, parent, basePath + cpuPath + "/idle", stream.str());
-        stream = std::stringstream();
-        stream << std::fixed << std::setprecision(2)
-               << mIowait / static_cast<long double>(mTotal) * 100.0;
-        setXpath(session, parent, basePath + cpuPath + "/wait", stream.str());
-        stream = std::stringstream();
-        stream << std::fixed << std::setprecision(2)
-               << mIrq / static_cast<long double>(mTotal) * 100.0;
-        setXpath(session, parent, basePath + cpuPath + "/irq", stream.str());
-        stream = std::stringstream();
-        stream << std::fixed << std::setprecision(2)
-               << mSoftirq / static_cast<long double>(mTotal) * 100.0;
-        setXpath(session, parent, basePath + cpuPath + "/softirq", stream.str());
-        stream = std::stringstream();
-        stream << std::fixed << std::setprecision(2)
-               << mStolen / static_cast<long double>(mTotal) * 100.0;
-        setXpath(session, parent, basePath + cpuPath + "/stolen", stream.str());
-    }
-
-    void populateValues(std::vector<size_t> const& cpu_times) {
-        mUser = cpu_times[0];
-        mNice = cpu_times[1];
-        mSystem = cpu_times[2];
-        mIdle = cpu_times[3];
-        mIowait = cpu_times[4];
-        mIrq = cpu_times[5];
-        mSoftirq = cpu_times[6];
-        mStolen = cpu_times[7];
-
-        mTotal = accumulate(cpu_times.begin(), cpu_times.end(), 0);
+                        char const* path) const {
+        lyd_node* node(createXpath(session, parent, path));
+        if (node) {
+            setCpuTimesXpath(node, percentages());
+        }
+    }
+
+    /// @brief The times as percentages of the total.
+    CpuStateTimes percentages() const {
+        double const scale(100.0 / std::max(mTotal, 1.0));
+        CpuStateTimes percent;
+        for (size_t state = 0; state < kCpuStates; state++) {
+            percent[state] = mTimes[state] * scale;
+        }
+        return percent;
+    }
+
+    void populateValues(Times const& cpu_times) {
+        std::copy_n(cpu_times.begin(), kCpuStates, mTimes.begin());
+        mTotal = std::accumulate(cpu_times.begin(), cpu_times.end(), size_t(0));
+    }
+
+    /// @brief Add the times of another core, e.g. of a core to the package it belongs to.
+    void add(CpuStateTimes const& times, double total) {
+        for (size_t state = 0; state < kCpuStates; state++) {
+            mTimes[state] += times[state];
+        }
+        mTotal += total;
+    }
+
+    /// @brief Times accumulated between the previous sample and this one.
+    CoreStats since(CoreStats const& previous) const {
+        // counters like iowait are not guaranteed to be monotonic
+        CoreStats delta;
+        for (size_t state = 0; state < kCpuStates; state++) {
+            delta.mTimes[state] = std::max(mTimes[state] - previous.mTimes[state], 0.0);
+        }
+        delta.mTotal = std::max(mTotal - previous.mTotal, 1.0);
+        return delta;
     }
 
 protected:
-    size_t mUser;
-    size_t mNice;
-    size_t mSystem;
-    size_t mIdle;
-    size_t mIowait;
-    size_t mIrq;
-    size_t mSoftirq;
-    size_t mStolen;
-    size_t mTotal;
+    // jiffies are exact in a double for far longer than any uptime
+    CpuStateTimes mTimes;
+    double mTotal;
+};
+
+/// @brief The times of all cores as one row per state, followed by a row of the totals, in one
+/// block. Deltas and percentages of all cores are plain loops over contiguous doubles, which
+/// the compiler vectorizes.
+struct CoreTimes {
+    static constexpr size_t kRows = kCpuStates + 1;
+
+    size_t size() const {
+        return mIds.size();
+    }
+
+    /// @brief The times are unspecified afterwards. The block keeps its capacity, so it only
+    /// reallocates when more cores are online than before.
+    void resize(size_t cores) {
+        mTimes.resize(kRows * cores);
+        mIds.resize(cores);
+    }
+
+    double* state(size_t row) {
+        return mTimes.data() + row * size();
+    }
+
+    double const* state(size_t row) const {
+        return mTimes.data() + row * size();
+    }
+
+    double* total() {
+        return state(kCpuStates);
+    }
+
+    double const* total() const {
+        return state(kCpuStates);
+    }
+
+    void set(size_t core, uint32_t id, CoreStats::Times const& times) {
+        for (size_t row = 0; row < kCpuStates; row++) {
+            state(row)[core] = times[row];
+        }
+        total()[core] = std::accumulate(times.begin(), times.end(), size_t(0));
+        mIds[core] = id;
+    }
+
+    CpuStateTimes times(size_t core) const {
+        CpuStateTimes times;
+        for (size_t row = 0; row < kCpuStates; row++) {
+            times[row] = state(row)[core];
+        }
+        return times;
+    }
+
+    /// @brief Times accumulated between the previous sample and this one. Cores are matched by
+    /// id, cores that went on- or offline in between are left out.
+    CoreTimes since(CoreTimes const& previous) const {
+        if (mIds == previous.mIds) {
+            return deltas(*this, previous);
+        }
+        // both are in ascending id order, as in /proc/stat
+        std::vector<std::pair<size_t, size_t>> common;
+        for (size_t i = 0, j = 0; i < size() && j < previous.size();) {
+            if (mIds[i] < previous.mIds[j]) {
+                i++;
+            } else if (previous.mIds[j] < mIds[i]) {
+                j++;
+            } else {
+                common.emplace_back(i++, j++);
+            }
+        }
+        // line the common cores up first
+        CoreTimes now, before;
+        now.resize(common.size());
+        before.resize(common.size());
+        for (size_t core = 0; core < common.size(); core++) {
+            auto const [i, j] = common[core];
+            for (size_t row = 0; row < kRows; row++) {
+                now.state(row)[core] = state(row)[i];
+                before.state(row)[core] = previous.state(row)[j];
+            }
+            now.mIds[core] = mIds[i];
+        }
+        return deltas(now, before);
+    }
+
+    /// @brief Turn the times into percentages of the total of their core, in place and in one
+    /// pass per state. The totals are 100 afterwards.
+    void toPercentages() {
+        double* const scale(total());
+        for (size_t core = 0; core < size(); core++) {
+            scale[core] = 100.0 / std::max(scale[core], 1.0);
+        }
+        for (size_t row = 0; row < kCpuStates; row++) {
+            double* const times(state(row));
+            for (size_t core = 0; core < size(); core++) {
+                times[core] *= scale[core];
+            }
+        }
+        std::fill(scale, scale + size(), 100.0);
+    }
+
+    std::vector<double> mTimes;  // kRows rows of size() cores
+    std::vector<uint32_t> mIds;  // the N of the cpuN line of each core
+
+private:
+    static CoreTimes deltas(CoreTimes const& now, CoreTimes const& before) {
+        CoreTimes delta;
+        delta.mTimes.resize(now.mTimes.size());
+        delta.mIds = now.mIds;
+        double const* const a(now.mTimes.data());
+        double const* const b(before.mTimes.data());
+        double* const d(delta.mTimes.data());
+        // counters like iowait are not guaranteed to be monotonic
+        for (size_t i = 0; i < delta.mTimes.size(); i++) {
+            d[i] = std::max(a[i] - b[i], 0.0);
+        }
+        return delta;
+    }
 };
 
 struct CpuStats : public CoreStats {
+    static constexpr char const* kLocation = "/proc/stat";
 
     CpuStats() = default;
 
-    CpuStats(std::vector<size_t> const& cpu_times) : CoreStats(cpu_times){};
+    /// @brief Utilization between the previous sample and this one.
+    CpuStats since(CpuStats const& previous) const {
+        CpuStats delta;
+        static_cast<CoreStats&>(delta) = CoreStats::since(previous);
+        delta.mCores = mCores.since(previous.mCores);
+        return delta;
+    }
 
     void printValues() const {
         CoreStats::printValues();
-        for (auto const& c : mCoreTimes) {
-            c.printValues();
+        for (size_t core = 0; core < mCores.size(); core++) {
+            for (double time : mCores.times(core)) {
+                std::cout << time << " ";
+            }
+            std::cout << mCores.total()[core] << std::endl;
         }
     }
 
+    /// @brief Sum the times of the cores of each group, the percentages of a group are then
+    /// the average of its cores weighted by their elapsed time.
+    /// @param groupOf the group of each core, nullopt for cores that belong to none
+    std::map<uint32_t, CoreStats>
+    rollup(std::vector<std::optional<uint32_t>> const& groupOf) const {
+        std::map<uint32_t, CoreStats> groups;
+        for (size_t core = 0; core < mCores.size() && core < groupOf.size(); core++) {
+            if (groupOf[core]) {
+                groups[groupOf[core].value()].add(mCores.times(core), mCores.total()[core]);
+            }
+        }
+        return groups;
+    }
+
+    /// @brief Set the statistics of the whole system, each core, socket and NUMA node. The
+    /// per-core times are turned into percentages in place on the way.
     void setXpathValues(sysrepo::Session session,
                         std::optional<libyang::DataNode>& parent,
                         std::string_view moduleName) {
         logMessage(SR_LL_DBG, "Setting xpath values for cpu statistics");
-        CoreStats::setXpathValues(session, parent, moduleName, std::nullopt);
-        for (size_t i = 0; i < mCoreTimes.size(); i++) {
-            mCoreTimes[i].setXpathValues(session, parent, moduleName, i);
+        Xpaths& xpaths(Xpaths::getInstance());
+        std::lock_guard lk(xpaths.mMtx);
+        CoreStats::setXpathValues(session, parent, xpaths.get(moduleName, Entry::Statistics, 0));
+
+        // the rollups weigh the cores by their times, so they come first
+        std::vector<std::optional<uint32_t>> packages, nodes;
+        CpuTopology::getInstance().lookup(mCores.mIds, packages, nodes);
+        for (auto const& [id, group] : rollup(packages)) {
+            group.setXpathValues(session, parent, xpaths.get(moduleName, Entry::Socket, id));
+        }
+        for (auto const& [id, group] : rollup(nodes)) {
+            group.setXpathValues(session, parent, xpaths.get(moduleName, Entry::NumaNode, id));
+        }
+
+        mCores.toPercentages();
+        for (size_t core = 0; core < mCores.size(); core++) {
+            lyd_node* node(createXpath(session, parent,
+                                       xpaths.get(moduleName, Entry::Cpu, mCores.mIds[core])));
+            if (node) {
+                setCpuTimesXpath(node, mCores.times(core));
+            }
         }
     }
 
-    void readCpuTimes() {
-        std::ifstream proc_stat("/proc/stat");
-        std::string line;
-        std::vector<size_t> cpu_times;
-        std::getline(proc_stat, line);
-        std::istringstream stream(line);
-        stream.ignore(5, ' ');  // ignore cpu keyword
-        for (size_t time; stream >> time; cpu_times.push_back(time))
-            ;
-        CoreStats::populateValues(cpu_times);
+    static void setLoadAverageXpathValues(sysrepo::Session session,
+                                          std::optional<libyang::DataNode>& parent,
+                                          std::string_view moduleName) {
+        double loadavg[3];
+        if (getloadavg(loadavg, 3) == -1) {
+            logMessage(SR_LL_ERR, "getloadavg call failed");
+            return;
+        }
+        Xpaths& xpaths(Xpaths::getInstance());
+        std::lock_guard lk(xpaths.mMtx);
+        lyd_node* node(createXpath(session, parent, xpaths.get(moduleName, Entry::AverageLoad, 0)));
+        if (!node) {
+            return;
+        }
+        setDecimalXpath(node, "avg-1min-load", loadavg[0]);
+        setDecimalXpath(node, "avg-5min-load", loadavg[1]);
+        setDecimalXpath(node, "avg-15min-load", loadavg[2]);
+    }
 
-        std::getline(proc_stat, line);
-        while (std::string(line).find("cpu") != std::string::npos) {
-            stream = std::istringstream(line);
-            stream.ignore(5, ' ');  // ignore cpu keyword
-            std::vector<size_t> cpu_times;
-            for (size_t time; stream >> time; cpu_times.push_back(time))
-                ;
-            CpuStats coreStats(cpu_times);
-            mCoreTimes.emplace_back(coreStats);
-            std::getline(proc_stat, line);
+    /// @brief Parse the times in place, the per-core arrays are reused and only grow when more
+    /// cores are online than at any read before.
+    /// @return false if /proc/stat could not be read
+    bool readCpuTimes(ProcFileReader& reader) {
+        auto content(reader.read());
+        if (!content) {
+            logMessage(SR_LL_ERR, "Reading /proc/stat failed");
+            return false;
         }
+        Times times;
+        std::optional<uint32_t> core;
+        if (parseLine(content.value(), core, times) == 0 || core) {
+            logMessage(SR_LL_ERR, "No aggregate cpu line in /proc/stat");
+            return false;
+        }
+        CoreStats::populateValues(times);
+        // the lines of the online cores follow, the ids have gaps for offline cores. They are
+        // counted first, the rows of the block depend on the number of cores.
+        size_t cores(0);
+        for (std::string_view rest(content.value()); rest.substr(0, 3) == "cpu"; cores++) {
+            rest.remove_prefix(std::min(rest.find('\n'), rest.size() - 1) + 1);
+        }
+        mCores.resize(cores);
+        for (size_t i = 0; i < cores; i++) {
+            if (parseLine(content.value(), core, times) == 0 || !core) {
+                logMessage(SR_LL_ERR, "Malformed cpu line in /proc/stat");
+                return false;
+            }
+            mCores.set(i, core.value(), times);
+        }
+        return true;
+    }
+
+    bool readCpuTimes() {
+        ProcFileReader reader(kLocation);
+        return readCpuTimes(reader);
     }
 
-    std::vector<CoreStats> mCoreTimes;
+    CoreTimes mCores;
+
+private:
+    enum class Entry { Statistics, Cpu, Socket, NumaNode, AverageLoad };
+
+    /// @brief Paths of the statistics entries, shared by all samples. They are keyed by the
+    /// cpu, package or node id, which keeps its meaning across hotplug, so they never go stale
+    /// and are bounded by the number of possible cpus.
+    struct Xpaths {
+        static Xpaths& getInstance() {
+            static Xpaths instance;
+            return instance;
+        }
+
+        Xpaths(Xpaths const&) = delete;
+        void operator=(Xpaths const&) = delete;
+
+        char const* get(std::string_view moduleName, Entry entry, uint32_t id) {
+            static char const* const kEntries[] = {"", "/cpu", "/socket", "/numa-node",
+                                                   "/average-load"};
+            return mCache.get(
+                moduleName, std::make_pair(entry, id), [entry, id](std::string_view moduleName) {
+                    std::string path("/" + std::string(moduleName) +
+                                     ":system-metrics/cpu-statistics");
+                    path += kEntries[static_cast<size_t>(entry)];
+                    if (entry != Entry::Statistics && entry != Entry::AverageLoad) {
+                        path += "[id='" + std::to_string(id) + "']";
+                    }
+                    return path;
+                });
+        }
+
+        std::mutex mMtx;
+
+    private:
+        Xpaths() = default;
+
+        XpathCache<std::pair<Entry, uint32_t>> mCache;
+    };
 };
 
 }  // namespace metrics
@@ -0,0 +1,113 @@
+// telekom / sysrepo-plugin-os-metrics
+//
+// This program is made available under the terms of the
+// BSD 3-Clause license which is available at
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// SPDX-FileCopyrightText: 2022 Deutsche Telekom AG
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef CPU_TOPOLOGY_H
+#define CPU_TOPOLOGY_H
+
+#include <utils/globals.h>
+
+#include <charconv>
+#include <cstring>
+#include <dirent.h>
+#include <fstream>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace metrics {
+
+/// @brief Physical package and NUMA node of each cpu, from sysfs. A cpu keeps both while it is
+/// offline, so each cpu is looked up once, the first time it is seen online.
+struct CpuTopology {
+    static constexpr char const* kLocation = "/sys/devices/system/cpu";
+
+    static CpuTopology& getInstance() {
+        static CpuTopology instance;
+        return instance;
+    }
+
+    CpuTopology(CpuTopology const&) = delete;
+    void operator=(CpuTopology const&) = delete;
+
+    /// @brief Package and node of each of the cpus, nullopt where sysfs does not tell, e.g. the
+    /// node on kernels without NUMA support.
+    void lookup(std::vector<uint32_t> const& cpus,
+                std::vector<std::optional<uint32_t>>& packages,
+                std::vector<std::optional<uint32_t>>& nodes) {
+        std::lock_guard lk(mMtx);
+        packages.resize(cpus.size());
+        nodes.resize(cpus.size());
+        for (size_t i = 0; i < cpus.size(); i++) {
+            uint32_t const cpu(cpus[i]);
+            if (cpu >= mCpus.size()) {
+                mCpus.resize(cpu + 1);
+            }
+            if (!mCpus[cpu].known) {
+                mCpus[cpu].package = readPackage(cpu);
+                mCpus[cpu].node = readNode(cpu);
+                mCpus[cpu].known = true;
+            }
+            packages[i] = mCpus[cpu].package;
+            nodes[i] = mCpus[cpu].node;
+        }
+    }
+
+private:
+    struct Cpu {
+        bool known = false;
+        std::optional<uint32_t> package;
+        std::optional<uint32_t> node;
+    };
+
+    CpuTopology() = default;
+
+    static std::optional<uint32_t> readPackage(uint32_t cpu) {
+        std::ifstream file(std::string(kLocation) + "/cpu" + std::to_string(cpu) +
+                           "/topology/physical_package_id");
+        // -1 where the architecture does not know the package
+        int64_t id;
+        if (!(file >> id) || id < 0) {
+            return std::nullopt;
+        }
+        return id;
+    }
+
+    /// @brief The node is the nodeN link in the directory of the cpu.
+    static std::optional<uint32_t> readNode(uint32_t cpu) {
+        std::string const path(std::string(kLocation) + "/cpu" + std::to_string(cpu));
+        DIR* dir = opendir(path.c_str());
+        if (!dir) {
+            return std::nullopt;
+        }
+        std::optional<uint32_t> node;
+        while (struct dirent* entry = readdir(dir)) {
+            if (strncmp(entry->d_name, "node", 4) != 0) {
+                continue;
+            }
+            char const* const last(entry->d_name + strlen(entry->d_name));
+            uint32_t id;
+            auto const result = std::from_chars(entry->d_name + 4, last, id);
+            if (result.ec == std::errc() && result.ptr == last) {
+                node = id;
+                break;
+            }
+        }
+        closedir(dir);
+        return node;
+    }
+
+    std::mutex mMtx;
+    std::vector<Cpu> mCpus;  // indexed by cpu id
+};
+
+}  // namespace metrics
+
+#endif  // CPU_TOPOLOGY_H
@@ -11,14 +11,16 @@
 #ifndef FILESYSTEM_STATS_H
 #define FILESYSTEM_STATS_H
 
+#include <mount_table.h>
+#include <statvfs_prober.h>
 #include <utils/globals.h>
+#include <xpath_cache.h>
 
-#include <fstream>
-#include <iomanip>
+#include <iostream>
 #include <mutex>
 #include <numeric>
-#include <sstream>
 #include <sys/statvfs.h>
+#include <unordered_set>
 
 namespace metrics {
 
@@ -34,30 +36,51 @@ struct Filesystem {
         std::cout << "blocksize: " << blocksize << std::endl;
         std::cout << "inodeUsed: " << inodeUsed << std::endl;
         std::cout << "spaceUsed: " << spaceUsed << std::endl;
+        std::cout << "stale: " << stale << std::endl;
     }
 
+    /// @param statisticsPath path of the statistics container of this filesystem
     void setXpathValues(sysrepo::Session session,
                         std::optional<libyang::DataNode>& parent,
-                        std::string_view moduleName) const {
-        std::string filesystemPath("/" + std::string(moduleName) +
-                                   ":system-metrics/filesystems/filesystem[mount-point='" +
-                                   mountPoint + "']/statistics/");
-        setXpath(session, parent, filesystemPath + "name", name);
-        setXpath(session, parent, filesystemPath + "type", type);
-        setXpath(session, parent, filesystemPath + "total-blocks", std::to_string(totalBlocks));
-        setXpath(session, parent, filesystemPath + "used-blocks", std::to_string(usedBlocks));
-        setXpath(session, parent, filesystemPath + "avail-blocks", std::to_string(availableBlocks));
-        setXpath(session, parent, filesystemPath + "blocksize", std::to_string(blocksize));
+                        char const* statisticsPath) const {
+        // the statistics node is resolved once, its leaves are added relative to it
+        lyd_node* statistics(createXpath(session, parent, statisticsPath));
+        if (!statistics) {
+            return;
+        }
+        setXpath(statistics, "name", name.c_str());
+        setXpath(statistics, "type", type.c_str());
+        setXpath(statistics, "stale", stale ? "true" : "false");
+        if (!sampled) {
+            return;
+        }
+        setXpath(statistics, "total-blocks", totalBlocks);
+        setXpath(statistics, "used-blocks", usedBlocks);
+        setXpath(statistics, "avail-blocks", availableBlocks);
+        setXpath(statistics, "blocksize", blocksize);
 
-        {
-            std::stringstream stream;
-            stream << std::fixed << std::setprecision(2) << spaceUsed;
-            setXpath(session, parent, filesystemPath + "space-used", stream.str());
+        setPercentXpath(statistics, "space-used", spaceUsed);
+        setPercentXpath(statistics, "inode-used", inodeUsed);
+    }
+
+    void populateValues(struct statvfs const& buf) {
+        sampled = true;
+        stale = false;
+        blocksize = buf.f_bsize / 1024;  // KB
+        totalBlocks = buf.f_blocks;
+        availableBlocks = buf.f_bfree;
+        usedBlocks = totalBlocks - availableBlocks;
+        uint64_t const inodesTotal = buf.f_files;
+        uint64_t const inodesUsed = inodesTotal - buf.f_ffree;
+        if (inodesTotal == 0) {
+            inodeUsed = 0;
+        } else {
+            inodeUsed = inodesUsed * 100.0 / static_cast<double>(inodesTotal);
         }
-        {
-            std::stringstream stream;
-            stream << std::fixed << std::setprecision(2) << inodeUsed;
-            setXpath(session, parent, filesystemPath + "inode-used", stream.str());
+        if (totalBlocks == 0) {
+            spaceUsed = 0;
+        } else {
+            spaceUsed = usedBlocks * 100.0 / static_cast<double>(totalBlocks);
         }
     }
 
@@ -68,8 +91,10 @@ struct Filesystem {
     uint64_t usedBlocks = 0;
     uint64_t availableBlocks = 0;
     uint64_t blocksize = 1;  // KB
-    long double inodeUsed = 0;
-    long double spaceUsed = 0;
+    double inodeUsed = 0;
+    double spaceUsed = 0;
+    bool sampled = false;  // at least one statvfs call answered
+    bool stale = false;    // last statvfs call timed out, values are from an earlier call
 };
 
 struct FilesystemStats {
@@ -82,65 +107,53 @@ struct FilesystemStats {
     FilesystemStats(FilesystemStats const&) = delete;
     void operator=(FilesystemStats const&) = delete;
 
+    /// @brief Probe all mounts. The lock is not held while probing, queries of other callers
+    /// do not wait for hung mounts.
     void readFilesystemStats() {
-        std::lock_guard lk(mMtx);
-        int rc = system("/bin/df -T > " FILESYSTEM_STATS_LOCATION
-                        "&& /bin/df -i > " FILESYSTEM_STATS_LOCATION2);
-        if (rc == -1) {
-            logMessage(SR_LL_ERR, "df command failed");
-            return;
-        }
-        logMessage(SR_LL_DBG, "df command returned:" + std::to_string(rc));
-        std::string token, inodesToken;
-        std::ifstream file(FILESYSTEM_STATS_LOCATION), fileinodes(FILESYSTEM_STATS_LOCATION2);
-        file.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-        fileinodes.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-        while (file >> token || fileinodes >> inodesToken) {
-            Filesystem fs;
-            uint64_t inodesTotal;
-            uint64_t inodesUsed;
-            fs.name = token;
-            file >> fs.type >> fs.totalBlocks >> fs.usedBlocks >> fs.availableBlocks >> token >>
-                fs.mountPoint;
-            fileinodes >> token >> inodesTotal >> inodesUsed;
-
-            struct statvfs buf;
-            if (statvfs(fs.mountPoint.c_str(), &buf) == 0) {
-                fs.blocksize = buf.f_bsize / 1024;  // KB
-                fs.totalBlocks = buf.f_blocks;
-                fs.availableBlocks = buf.f_bfree;
-                fs.usedBlocks = fs.totalBlocks - fs.availableBlocks;
-                inodesTotal = buf.f_files;
-                inodesUsed = inodesTotal - buf.f_ffree;
-            } else {
-                logMessage(SR_LL_ERR, "statvfs call failed");
-            }
-            if (inodesTotal == 0) {
-                fs.inodeUsed = 0;
-            } else {
-                fs.inodeUsed = inodesUsed * 100.0 / static_cast<long double>(inodesTotal);
+        std::vector<MountEntry> mounts;
+        std::vector<std::string> mountPoints;
+        {
+            std::lock_guard lk(mMtx);
+            if (mMountTable.refresh()) {
+                evictUnmounted();
             }
-            if (fs.totalBlocks == 0) {
-                fs.spaceUsed = 0;
-            } else {
-                fs.spaceUsed = fs.usedBlocks * 100.0 / static_cast<long double>(fs.totalBlocks);
+            for (auto const& mount : mMountTable.mounts()) {
+                if (mPseudoMounts.find(mount.mountPoint) == mPseudoMounts.end()) {
+                    mounts.push_back(mount);
+                    mountPoints.push_back(mount.mountPoint);
+                }
             }
-            fsMap.emplace(std::make_pair(fs.mountPoint, fs));
-            // ignore rest of the line
-            file.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-            fileinodes.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        }
+        std::vector<StatvfsProber::Result> const results(
+            StatvfsProber::getInstance().probe(mountPoints));
+        std::lock_guard lk(mMtx);
+        for (size_t i = 0; i < mounts.size(); i++) {
+            applyResult(mounts[i], results[i]);
         }
     }
 
-    std::optional<long double> getUsage(std::string mountPoint) {
-        readFilesystemStats();
+    /// @brief Usage of a single mount point, costs one statvfs call.
+    std::optional<double> getUsage(std::string const& mountPoint) {
+        MountEntry mount;
+        {
+            std::lock_guard lk(mMtx);
+            if (mMountTable.refresh()) {
+                evictUnmounted();
+            }
+            MountEntry const* entry = mMountTable.find(mountPoint);
+            if (!entry || mPseudoMounts.find(mountPoint) != mPseudoMounts.end()) {
+                return std::nullopt;
+            }
+            mount = *entry;
+        }
+        StatvfsProber::Result const result(
+            StatvfsProber::getInstance().probe({mountPoint}).front());
         std::lock_guard lk(mMtx);
-        std::unordered_map<std::string, Filesystem>::iterator itr;
-        if ((itr = fsMap.find(mountPoint)) != fsMap.end()) {
-            return itr->second.spaceUsed;
-        } else {
+        Filesystem const* fs = applyResult(mount, result);
+        if (!fs || !fs->sampled) {
             return std::nullopt;
         }
+        return fs->spaceUsed;
     }
 
     void printValues() const {
@@ -156,14 +169,75 @@ struct FilesystemStats {
         std::lock_guard lk(mMtx);
         logMessage(SR_LL_DBG, "Setting xpath values for filesystems statistics");
         for (auto const& v : fsMap) {
-            v.second.setXpathValues(session, parent, moduleName);
+            char const* const path(
+                mXpaths.get(moduleName, v.first, [&v](std::string_view moduleName) {
+                    return "/" + std::string(moduleName) +
+                           ":system-metrics/filesystems/filesystem" +
+                           keyPredicate("mount-point", v.first) + "/statistics";
+                }));
+            v.second.setXpathValues(session, parent, path);
         }
     }
 
 private:
     FilesystemStats() = default;
+
+    /// @brief Store the outcome of a statvfs probe for a mount, the lock is held.
+    /// @return the updated entry, nullptr if the mount is not reported
+    Filesystem const* applyResult(MountEntry const& mount, StatvfsProber::Result const& result) {
+        // the table may have been refreshed while probing
+        if (!mMountTable.find(mount.mountPoint)) {
+            return nullptr;
+        }
+        if (result.status == StatvfsProber::Status::Failed) {
+            logMessage(SR_LL_WRN, "statvfs call failed for: ", mount.mountPoint);
+            return nullptr;
+        }
+        if (result.status == StatvfsProber::Status::TimedOut) {
+            // keep the last known values and flag them as stale. A mount that never answered
+            // may be a pseudo filesystem, it is not reported until it does.
+            auto const itr = fsMap.find(mount.mountPoint);
+            if (itr == fsMap.end()) {
+                return nullptr;
+            }
+            itr->second.stale = true;
+            return &itr->second;
+        }
+        // pseudo filesystems (proc, sysfs, cgroup...) report no blocks, df hides them too,
+        // skip them until the mount table changes
+        if (result.buf.f_blocks == 0) {
+            mPseudoMounts.insert(mount.mountPoint);
+            fsMap.erase(mount.mountPoint);
+            return nullptr;
+        }
+        Filesystem& fs = fsMap[mount.mountPoint];
+        fs.name = mount.device;
+        fs.mountPoint = mount.mountPoint;
+        fs.type = mount.type;
+        fs.populateValues(result.buf);
+        return &fs;
+    }
+
+    /// @brief Drop entries of mount points that are no longer mounted.
+    void evictUnmounted() {
+        for (auto itr = fsMap.begin(); itr != fsMap.end();) {
+            if (!mMountTable.find(itr->first)) {
+                logMessage(SR_LL_DBG, "Filesystem unmounted: ", itr->first);
+                itr = fsMap.erase(itr);
+            } else {
+                ++itr;
+            }
+        }
+        mPseudoMounts.clear();
+        // paths of mount points that are gone would pile up otherwise
+        mXpaths.clear();
+    }
+
     std::mutex mMtx;
+    MountTable mMountTable;
+    std::unordered_set<std::string> mPseudoMounts;
     std::unordered_map<std::string, Filesystem> fsMap;
+    XpathCache<std::string> mXpaths;  // statistics paths by mount point
 };
 
 }  // namespace metrics
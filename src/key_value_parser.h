@@ -0,0 +1,83 @@
+// telekom / sysrepo-plugin-os-metrics
+//
+// This program is made available under the terms of the
+// BSD 3-Clause license which is available at
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// SPDX-FileCopyrightText: 2022 Deutsche Telekom AG
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef KEY_VALUE_PARSER_H
+#define KEY_VALUE_PARSER_H
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstdint>
+#include <string_view>
+
+namespace metrics {
+
+/// @brief Parser of procfs files made of "Key: value" lines, like /proc/meminfo and the status
+/// and io files of a process. The keys it knows are a table sorted at compile time, each with
+/// the member of T its value is stored in. Unknown keys are skipped, a unit after the value
+/// like "kB" is ignored.
+template <typename T, typename Member, size_t N>
+struct KeyValueParser {
+    struct Field {
+        std::string_view key;  // without the colon
+        Member T::*member;
+    };
+
+    constexpr KeyValueParser(std::array<Field, N> fields) : mFields(fields) {
+        std::sort(mFields.begin(), mFields.end(),
+                  [](Field const& a, Field const& b) { return before(a.key, b.key); });
+    }
+
+    void parse(std::string_view content, T& target) const {
+        while (!content.empty()) {
+            size_t const eol = std::min(content.find('\n'), content.size());
+            std::string_view const line(content.substr(0, eol));
+            content.remove_prefix(std::min(eol + 1, content.size()));
+
+            size_t const colon = line.find(':');
+            if (colon == std::string_view::npos) {
+                continue;
+            }
+            Field const* field(find(line.substr(0, colon)));
+            if (!field) {
+                continue;
+            }
+            size_t const begin = line.find_first_not_of(" \t", colon + 1);
+            if (begin == std::string_view::npos) {
+                continue;
+            }
+            uint64_t value;
+            if (std::from_chars(line.data() + begin, line.data() + line.size(), value).ec ==
+                std::errc()) {
+                target.*(field->member) = value;
+            }
+        }
+    }
+
+    constexpr Field const* find(std::string_view key) const {
+        auto const itr = std::lower_bound(
+            mFields.begin(), mFields.end(), key,
+            [](Field const& field, std::string_view key) { return before(field.key, key); });
+        return itr != mFields.end() && itr->key == key ? &*itr : nullptr;
+    }
+
+private:
+    /// @brief Order by length first, most keys of a file are then told apart without looking
+    /// at their characters.
+    static constexpr bool before(std::string_view a, std::string_view b) {
+        return a.size() != b.size() ? a.size() < b.size() : a < b;
+    }
+
+    std::array<Field, N> mFields;
+};
+
+}  // namespace metrics
+
+#endif  // KEY_VALUE_PARSER_H
@@ -11,15 +11,15 @@
 #ifndef MEMORY_STATS_H
 #define MEMORY_STATS_H
 
+#include <key_value_parser.h>
+#include <proc_reader.h>
 #include <utils/globals.h>
+#include <xpath_cache.h>
 
-#include <fstream>
-#include <functional>
-#include <iomanip>
+#include <iostream>
 #include <map>
 #include <mutex>
 #include <numeric>
-#include <sstream>
 
 namespace metrics {
 
@@ -38,60 +38,66 @@ struct MemoryStats {
                         std::string_view moduleName) {
         std::lock_guard lk(mMtx);
         logMessage(SR_LL_DBG, "Setting xpath values for memory statistics");
-        std::string memoryPath("/" + std::string(moduleName) +
-                               ":system-metrics/memory/statistics/");
-        setXpath(session, parent, memoryPath + "free", std::to_string(mFree / 1024ULL));
-        setXpath(session, parent, memoryPath + "swap-free-mb", std::to_string(mSwapFree / 1024ULL));
-        setXpath(session, parent, memoryPath + "swap-total", std::to_string(mSwapTotal / 1024ULL));
-        setXpath(session, parent, memoryPath + "swap-used", std::to_string(mSwapUsed / 1024ULL));
-        setXpath(session, parent, memoryPath + "total", std::to_string(mTotal / 1024ULL));
-        setXpath(session, parent, memoryPath + "usable-mb", std::to_string(mUsable / 1024ULL));
-        setXpath(session, parent, memoryPath + "used-buffers",
-                 std::to_string(mUsedBuffers / 1024ULL));
-        setXpath(session, parent, memoryPath + "used-cached",
-                 std::to_string(mUsedCached / 1024ULL));
-        setXpath(session, parent, memoryPath + "used-shared",
-                 std::to_string(mUsedShared / 1024ULL));
-        setXpath(session, parent, memoryPath + "hugepages-total", std::to_string(mHugePagesTotal));
-        setXpath(session, parent, memoryPath + "hugepages-free", std::to_string(mHugePagesFree));
-        setXpath(session, parent, memoryPath + "hugepage-size", std::to_string(mHugePageSize));
+        char const* const statisticsPath(
+            mXpaths.get(moduleName, 0, [](std::string_view moduleName) {
+                return "/" + std::string(moduleName) + ":system-metrics/memory/statistics";
+            }));
+        // the statistics node is resolved once, its leaves are added relative to it
+        lyd_node* statistics(createXpath(session, parent, statisticsPath));
+        if (!statistics) {
+            return;
+        }
+        setXpath(statistics, "free", mFree / 1024ULL);
+        setXpath(statistics, "swap-free-mb", mSwapFree / 1024ULL);
+        setXpath(statistics, "swap-total", mSwapTotal / 1024ULL);
+        setXpath(statistics, "swap-used", mSwapUsed / 1024ULL);
+        setXpath(statistics, "total", mTotal / 1024ULL);
+        setXpath(statistics, "usable-mb", mUsable / 1024ULL);
+        setXpath(statistics, "used-buffers", mUsedBuffers / 1024ULL);
+        setXpath(statistics, "used-cached", mUsedCached / 1024ULL);
+        setXpath(statistics, "used-shared", mUsedShared / 1024ULL);
+        setXpath(statistics, "hugepages-total", mHugePagesTotal);
+        setXpath(statistics, "hugepages-free", mHugePagesFree);
+        setXpath(statistics, "hugepage-size", mHugePageSize);
 
         if (mTotal != 0) {
-            long double usable = mUsable / static_cast<long double>(mTotal) * 100.0;
-            std::stringstream stream;
-            stream << std::fixed << std::setprecision(2) << usable;
-            setXpath(session, parent, memoryPath + "usable-perc", stream.str());
+            setPercentXpath(statistics, "usable-perc",
+                            mUsable / static_cast<double>(mTotal) * 100.0);
         }
         if (mSwapTotal != 0) {
-            long double swapFree = mSwapFree / static_cast<long double>(mSwapTotal) * 100.0;
-            std::stringstream stream;
-            stream << std::fixed << std::setprecision(2) << swapFree;
-            setXpath(session, parent, memoryPath + "swap-free-perc", stream.str());
+            setPercentXpath(statistics, "swap-free-perc",
+                            mSwapFree / static_cast<double>(mSwapTotal) * 100.0);
         }
     }
 
     void readMemoryStats() {
+        static constexpr KeyValueParser<MemoryStats, uint64_t, 11> kFields{{{
+            {"MemTotal", &MemoryStats::mTotal},
+            {"MemFree", &MemoryStats::mFree},
+            {"MemAvailable", &MemoryStats::mUsable},
+            {"SwapTotal", &MemoryStats::mSwapTotal},
+            {"SwapFree", &MemoryStats::mSwapFree},
+            {"Shmem", &MemoryStats::mUsedShared},
+            {"Cached", &MemoryStats::mUsedCached},
+            {"Buffers", &MemoryStats::mUsedBuffers},
+            {"HugePages_Total", &MemoryStats::mHugePagesTotal},
+            {"HugePages_Free", &MemoryStats::mHugePagesFree},
+            {"Hugepagesize", &MemoryStats::mHugePageSize},
+        }}};
         std::lock_guard lk(mMtx);
-        std::string token;
-        std::ifstream file("/proc/meminfo");
-        while (file >> token) {
-            auto const& itr = assignMap.find(token);
-            if (itr != assignMap.end()) {
-                uint64_t mem;
-                if (file >> mem) {
-                    assignMap[token](mem);
-                }
-            }
-            // ignore rest of the line
-            file.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        auto const content(mMeminfo.read());
+        if (!content) {
+            logMessage(SR_LL_ERR, "Reading /proc/meminfo failed");
+            return;
         }
+        kFields.parse(content.value(), *this);
         mSwapUsed = mSwapTotal - mSwapFree;
     }
 
-    long double getUsage() {
+    double getUsage() {
         readMemoryStats();
         std::lock_guard lk(mMtx);
-        return 100.0 - (mUsable / static_cast<long double>(mTotal) * 100.0);
+        return 100.0 - (mUsable / static_cast<double>(mTotal) * 100.0);
     }
 
     void printValues() const {
@@ -111,24 +117,13 @@ struct MemoryStats {
 
 private:
     MemoryStats()
-        : mFree(0), mSwapFree(0), mSwapTotal(0), mSwapUsed(0), mTotal(0), mUsable(0),
-          mUsedBuffers(0), mUsedCached(0), mUsedShared(0), mHugePagesTotal(0), mHugePagesFree(0),
-          mHugePageSize(0) {
-        assignMap = {{"MemTotal:", [this](uint64_t value) { mTotal = value; }},
-                     {"MemFree:", [this](uint64_t value) { mFree = value; }},
-                     {"MemAvailable:", [this](uint64_t value) { mUsable = value; }},
-                     {"SwapTotal:", [this](uint64_t value) { mSwapTotal = value; }},
-                     {"SwapFree:", [this](uint64_t value) { mSwapFree = value; }},
-                     {"Shmem:", [this](uint64_t value) { mUsedShared = value; }},
-                     {"Cached:", [this](uint64_t value) { mUsedCached = value; }},
-                     {"Buffers:", [this](uint64_t value) { mUsedBuffers = value; }},
-                     {"HugePages_Total:", [this](uint64_t value) { mHugePagesTotal = value; }},
-                     {"HugePages_Free:", [this](uint64_t value) { mHugePagesFree = value; }},
-                     {"Hugepagesize:", [this](uint64_t value) { mHugePageSize = value; }}};
-    }
+        : mMeminfo("/proc/meminfo"), mFree(0), mSwapFree(0), mSwapTotal(0), mSwapUsed(0),
+          mTotal(0), mUsable(0), mUsedBuffers(0), mUsedCached(0), mUsedShared(0),
+          mHugePagesTotal(0), mHugePagesFree(0), mHugePageSize(0){};
 
-    std::unordered_map<std::string, std::function<void(uint64_t)>> assignMap;
     std::mutex mMtx;
+    ProcFileReader mMeminfo;
+    XpathCache<int> mXpaths;  // the statistics path, the only key is 0
 
 public:
     uint64_t mFree;
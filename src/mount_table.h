@@ -0,0 +1,178 @@
+// telekom / sysrepo-plugin-os-metrics
+//
+// This program is made available under the terms of the
+// BSD 3-Clause license which is available at
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// SPDX-FileCopyrightText: 2022 Deutsche Telekom AG
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef MOUNT_TABLE_H
+#define MOUNT_TABLE_H
+
+#include <utils/globals.h>
+
+#include <algorithm>
+#include <fcntl.h>
+#include <fstream>
+#include <poll.h>
+#include <string>
+#include <string_view>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+#define MOUNTINFO_LOCATION "/proc/self/mountinfo"
+#define MOUNTS_LOCATION "/proc/self/mounts"
+
+namespace metrics {
+
+struct MountEntry {
+    std::string device;
+    std::string mountPoint;
+    std::string type;
+};
+
+/// @brief Cached view of the mount table, only re-read when the kernel signals a mount or
+/// unmount through POLLPRI on /proc/self/mounts. Not thread safe, callers serialize access.
+struct MountTable {
+
+    MountTable() : mFd(open(MOUNTS_LOCATION, O_RDONLY | O_CLOEXEC)), mValid(false) {
+        if (mFd < 0) {
+            logMessage(SR_LL_WRN, "Unable to watch " MOUNTS_LOCATION
+                                  ", mount table will be re-read on every query");
+        }
+    }
+
+    ~MountTable() {
+        if (mFd >= 0) {
+            close(mFd);
+        }
+    }
+
+    MountTable(MountTable const&) = delete;
+    void operator=(MountTable const&) = delete;
+
+    /// @brief Re-read the mount table if it changed since the last call.
+    /// @return true if the table was rebuilt
+    bool refresh() {
+        if (mValid && !changed()) {
+            return false;
+        }
+        mMounts.clear();
+        mIndex.clear();
+        for (auto& mount : readMountInfo()) {
+            // a later entry for the same mount point is the one stacked on top
+            auto const [itr, inserted] = mIndex.try_emplace(mount.mountPoint, mMounts.size());
+            if (inserted) {
+                mMounts.push_back(std::move(mount));
+            } else {
+                mMounts[itr->second] = std::move(mount);
+            }
+        }
+        mValid = true;
+        logMessage(SR_LL_DBG, "Mount table rebuilt, ", mMounts.size(), " mount points.");
+        return true;
+    }
+
+    std::vector<MountEntry> const& mounts() const {
+        return mMounts;
+    }
+
+    MountEntry const* find(std::string const& mountPoint) const {
+        auto const itr = mIndex.find(mountPoint);
+        if (itr == mIndex.end()) {
+            return nullptr;
+        }
+        return &mMounts[itr->second];
+    }
+
+    /// @brief Decode the octal escapes (\040, \011, \012, \134) the kernel uses for whitespace
+    /// and backslashes in mountinfo paths.
+    static std::string unescape(std::string_view field) {
+        std::string result;
+        result.reserve(field.size());
+        for (size_t i = 0; i < field.size(); i++) {
+            if (field[i] == '\\' && i + 3 < field.size() && isOctal(field[i + 1]) &&
+                isOctal(field[i + 2]) && isOctal(field[i + 3])) {
+                result.push_back(static_cast<char>((field[i + 1] - '0') * 64 +
+                                                   (field[i + 2] - '0') * 8 + (field[i + 3] - '0')));
+                i += 3;
+            } else {
+                result.push_back(field[i]);
+            }
+        }
+        return result;
+    }
+
+    /// @brief Parse one mountinfo line, see proc(5):
+    /// "36 35 98:0 /mnt1 /mnt/parent rw,noatime master:1 - ext3 /dev/root rw,errors=continue"
+    static bool parseLine(std::string_view line, MountEntry& entry) {
+        std::vector<std::string_view> fields;
+        size_t pos = 0;
+        while (pos < line.size()) {
+            size_t const end = std::min(line.find(' ', pos), line.size());
+            if (end > pos) {
+                fields.push_back(line.substr(pos, end - pos));
+            }
+            pos = end + 1;
+        }
+        // optional fields are terminated by a single hyphen
+        size_t separator = 6;
+        while (separator < fields.size() && fields[separator] != "-") {
+            separator++;
+        }
+        if (fields.size() < 5 || separator + 2 >= fields.size()) {
+            return false;
+        }
+        entry.mountPoint = unescape(fields[4]);
+        entry.type = unescape(fields[separator + 1]);
+        entry.device = unescape(fields[separator + 2]);
+        return true;
+    }
+
+    static std::vector<MountEntry> readMountInfo() {
+        std::vector<MountEntry> mounts;
+        std::ifstream file(MOUNTINFO_LOCATION);
+        if (!file) {
+            logMessage(SR_LL_ERR, "Unable to open " MOUNTINFO_LOCATION);
+            return mounts;
+        }
+        std::string line;
+        MountEntry entry;
+        while (std::getline(file, line)) {
+            if (parseLine(line, entry)) {
+                mounts.push_back(entry);
+            }
+        }
+        return mounts;
+    }
+
+private:
+    static bool isOctal(char c) {
+        return c >= '0' && c <= '7';
+    }
+
+    /// @brief The kernel flags POLLERR | POLLPRI on an open mounts file once per change of the
+    /// mount namespace, polling consumes the event.
+    bool changed() const {
+        if (mFd < 0) {
+            return true;
+        }
+        struct pollfd pfd = {mFd, POLLPRI, 0};
+        if (poll(&pfd, 1, 0) < 0) {
+            return true;
+        }
+        return pfd.revents & (POLLPRI | POLLERR);
+    }
+
+    int mFd;
+    bool mValid;
+    std::vector<MountEntry> mMounts;
+    std::unordered_map<std::string, size_t> mIndex;
+};
+
+}  // namespace metrics
+
+#endif  // MOUNT_TABLE_H
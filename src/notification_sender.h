@@ -0,0 +1,175 @@
+// telekom / sysrepo-plugin-os-metrics
+//
+// This program is made available under the terms of the
+// BSD 3-Clause license which is available at
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// SPDX-FileCopyrightText: 2022 Deutsche Telekom AG
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef NOTIFICATION_SENDER_H
+#define NOTIFICATION_SENDER_H
+
+#include <utils/globals.h>
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <sysrepo-cpp/Connection.hpp>
+#include <thread>
+
+namespace metrics {
+
+/// @brief Sends threshold notifications from a bounded queue over one long-lived session, so
+/// the threads checking the thresholds never block on sysrepo.
+struct NotificationSender {
+    static constexpr size_t kMaxQueueDepth = 1024;
+
+    struct Notification {
+        std::string type;  // memory or filesystem
+        std::string name;
+        std::string mountPoint;
+        bool rising;
+        double usage;
+    };
+
+    struct Counters {
+        uint64_t depth = 0;
+        uint64_t sent = 0;
+        uint64_t dropped = 0;
+        uint64_t failed = 0;
+    };
+
+    NotificationSender() : mStop(false){};
+
+    NotificationSender(NotificationSender const&) = delete;
+    void operator=(NotificationSender const&) = delete;
+
+    ~NotificationSender() {
+        stop();
+    }
+
+    void start(std::shared_ptr<sysrepo::Connection> conn, std::string const& moduleName) {
+        std::lock_guard lk(mMtx);
+        mConn = conn;
+        mModuleName = moduleName;
+        mStop = false;
+        if (!mThread.joinable()) {
+            mThread = std::thread(&NotificationSender::runFunc, this);
+        }
+    }
+
+    /// @brief Send what is queued, then join the sender thread and release the session and the
+    /// connection. Notifications queued afterwards wait for the next start().
+    void stop() {
+        {
+            std::lock_guard lk(mMtx);
+            mStop = true;
+        }
+        mCV.notify_all();
+        if (mThread.joinable()) {
+            mThread.join();
+        }
+        // the sender thread is gone, nothing else touches the session
+        mSession.reset();
+        std::lock_guard lk(mMtx);
+        mConn.reset();
+    }
+
+    /// @brief Queue a notification, it is dropped if the queue is full.
+    bool enqueue(Notification notification) {
+        {
+            std::lock_guard lk(mMtx);
+            if (mQueue.size() >= kMaxQueueDepth) {
+                mCounters.dropped++;
+                return false;
+            }
+            mQueue.push_back(std::move(notification));
+        }
+        mCV.notify_one();
+        return true;
+    }
+
+    Counters counters() {
+        std::lock_guard lk(mMtx);
+        Counters counters(mCounters);
+        counters.depth = mQueue.size();
+        return counters;
+    }
+
+private:
+    void runFunc() {
+        std::unique_lock lk(mMtx);
+        while (true) {
+            mCV.wait(lk, [this] { return mStop || !mQueue.empty(); });
+            // the queue is drained before stopping
+            if (mQueue.empty()) {
+                break;
+            }
+            // send everything queued back-to-back, without holding the lock during IPC
+            std::deque<Notification> batch;
+            batch.swap(mQueue);
+            auto conn = mConn;
+            std::string const moduleName(mModuleName);
+            lk.unlock();
+
+            uint64_t sent(0), failed(0);
+            for (auto const& notification : batch) {
+                if (send(conn, moduleName, notification)) {
+                    sent++;
+                } else {
+                    failed++;
+                }
+            }
+
+            lk.lock();
+            mCounters.sent += sent;
+            mCounters.failed += failed;
+        }
+    }
+
+    bool send(std::shared_ptr<sysrepo::Connection> const& conn,
+              std::string const& moduleName,
+              Notification const& notification) {
+        if (!conn) {
+            return false;
+        }
+        try {
+            if (!mSession) {
+                mSession = conn->sessionStart();
+            }
+            std::string const notifPath("/" + moduleName + ":" + notification.type +
+                                        "-threshold-crossed");
+            auto input = mSession->getContext().newPath(notifPath + "/name", notification.name);
+            if (notification.type == "filesystem") {
+                input.newPath(notifPath + "/mount-point", notification.mountPoint);
+            }
+            input.newPath(notifPath + (notification.rising ? "/rising" : "/falling"));
+            input.newPath(notifPath + "/usage", formatPercent(notification.usage));
+
+            mSession->sendNotification(input, sysrepo::Wait::No);
+        } catch (std::exception const& e) {
+            logMessage(SR_LL_ERR, "Sending notification failed: ", e.what());
+            // start over with a fresh session on the next notification
+            mSession.reset();
+            return false;
+        }
+        return true;
+    }
+
+    std::shared_ptr<sysrepo::Connection> mConn;
+    std::string mModuleName;
+    std::optional<sysrepo::Session> mSession;  // only used by the sender thread
+    std::deque<Notification> mQueue;
+    Counters mCounters;
+    bool mStop;
+    std::mutex mMtx;
+    std::condition_variable mCV;
+    std::thread mThread;
+};
+
+}  // namespace metrics
+
+#endif  // NOTIFICATION_SENDER_H
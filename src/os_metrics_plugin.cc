@@ -31,39 +31,65 @@ static MetricsModel theModel;
 int sr_plugin_init_cb(sr_session_ctx_t* session, void** /*private_data*/) {
     sysrepo::Connection conn;
     sysrepo::Session ses = conn.sessionStart();
+    std::string const logging_config_xpath("/" + MetricsModel::moduleName + ":" +
+                                           "system-metrics/logging");
+    std::string const cpu_config_xpath("/" + MetricsModel::moduleName + ":" +
+                                       "system-metrics/cpu-sampling");
     std::string const cpu_state_xpath("/" + MetricsModel::moduleName + ":" +
                                       "system-metrics/cpu-statistics");
     std::string const memory_state_xpath("/" + MetricsModel::moduleName + ":" +
                                          "system-metrics/memory/statistics");
+    std::string const memory_notification_xpath("/" + MetricsModel::moduleName + ":" +
+                                                "system-metrics/memory/notification-queue");
     std::string const memory_config_xpath("/" + MetricsModel::moduleName + ":" +
                                           "system-metrics/memory");
     std::string const filesystem_state_xpath("/" + MetricsModel::moduleName + ":" +
                                              "system-metrics/filesystems");
-    std::string const processes_state_spath("/" + MetricsModel::moduleName + ":" +
-                                            "system-metrics/processes");
+    std::string const processes_config_xpath("/" + MetricsModel::moduleName + ":" +
+                                             "system-metrics/processes/collection");
+    // only the list, the collection config next to it is not replaced by the provider
+    std::string const processes_state_xpath("/" + MetricsModel::moduleName + ":" +
+                                            "system-metrics/processes/process");
     try {
         metrics::MemoryMonitoring::getInstance().injectConnection(conn, MetricsModel::moduleName);
         metrics::FilesystemMonitoring::getInstance().injectConnection(conn,
                                                                       MetricsModel::moduleName);
 
+        // first, so the configured level applies to the messages of the other subscriptions
         sysrepo::Subscription sub = ses.onModuleChange(
-            MetricsModel::moduleName, &metrics::Callback::memoryConfigCallback, memory_config_xpath,
-            0, sysrepo::SubscribeOptions::Enabled | sysrepo::SubscribeOptions::DoneOnly);
+            MetricsModel::moduleName, &metrics::Callback::loggingConfigCallback,
+            logging_config_xpath, 0,
+            sysrepo::SubscribeOptions::Enabled | sysrepo::SubscribeOptions::DoneOnly);
+        sub.onModuleChange(MetricsModel::moduleName, &metrics::Callback::memoryConfigCallback,
+                           memory_config_xpath, 0,
+                           sysrepo::SubscribeOptions::Enabled |
+                               sysrepo::SubscribeOptions::DoneOnly);
         sub.onModuleChange(MetricsModel::moduleName, &metrics::Callback::filesystemsConfigCallback,
                            filesystem_state_xpath, 0,
                            sysrepo::SubscribeOptions::Enabled |
                                sysrepo::SubscribeOptions::DoneOnly);
+        sub.onModuleChange(MetricsModel::moduleName, &metrics::Callback::processesConfigCallback,
+                           processes_config_xpath, 0,
+                           sysrepo::SubscribeOptions::Enabled |
+                               sysrepo::SubscribeOptions::DoneOnly);
+        sub.onModuleChange(MetricsModel::moduleName, &metrics::Callback::cpuSamplingConfigCallback,
+                           cpu_config_xpath, 0,
+                           sysrepo::SubscribeOptions::Enabled |
+                               sysrepo::SubscribeOptions::DoneOnly);
         sub.onOperGet(MetricsModel::moduleName, &metrics::Callback::cpuStateCallback,
                       cpu_state_xpath);
         sub.onOperGet(MetricsModel::moduleName, &metrics::Callback::memoryStateCallback,
                       memory_state_xpath);
+        sub.onOperGet(MetricsModel::moduleName,
+                      &metrics::Callback::memoryNotificationQueueCallback,
+                      memory_notification_xpath);
         sub.onOperGet(MetricsModel::moduleName, &metrics::Callback::filesystemStateCallback,
                       filesystem_state_xpath);
         sub.onOperGet(MetricsModel::moduleName, &metrics::Callback::processesStateCallback,
-                      processes_state_spath);
+                      processes_state_xpath);
         theModel.sub = std::make_shared<sysrepo::Subscription>(std::move(sub));
     } catch (std::exception const& e) {
-        logMessage(SR_LL_ERR, std::string("sr_plugin_init_cb: ") + e.what());
+        logMessage(SR_LL_ERR, "sr_plugin_init_cb: ", e.what());
         theModel.sub.reset();
         return SR_ERR_OPERATION_FAILED;
     }
@@ -72,6 +98,11 @@ int sr_plugin_init_cb(sr_session_ctx_t* session, void** /*private_data*/) {
 }
 
 void sr_plugin_cleanup_cb(sr_session_ctx_t* /*session*/, void* /*private_data*/) {
+    // stop the background work while the singletons it uses and the connection still exist,
+    // static destruction would tear them down in an order the running checks do not expect
+    metrics::CpuSampler::getInstance().stop();
+    metrics::MemoryMonitoring::getInstance().stop();
+    metrics::FilesystemMonitoring::getInstance().stop();
     theModel.sub.reset();
     logMessage(SR_LL_DBG, "plugin cleanup finished.");
 }
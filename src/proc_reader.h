@@ -0,0 +1,128 @@
+// telekom / sysrepo-plugin-os-metrics
+//
+// This program is made available under the terms of the
+// BSD 3-Clause license which is available at
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// SPDX-FileCopyrightText: 2022 Deutsche Telekom AG
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef PROC_READER_H
+#define PROC_READER_H
+
+#include <cstdint>
+#include <cstdio>
+#include <fcntl.h>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unistd.h>
+#include <vector>
+
+namespace metrics {
+
+/// @brief Reads the files of one /proc/<pid> directory relative to a directory fd, into a
+/// buffer that is reused for every file and process.
+struct ProcReader {
+
+    ProcReader() : mDirFd(-1), mBuffer(4096){};
+
+    ~ProcReader() {
+        close();
+    }
+
+    ProcReader(ProcReader const&) = delete;
+    void operator=(ProcReader const&) = delete;
+
+    bool open(int32_t pid) {
+        close();
+        char path[32];
+        snprintf(path, sizeof(path), "/proc/%d", pid);
+        mDirFd = ::open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        return mDirFd >= 0;
+    }
+
+    void close() {
+        if (mDirFd >= 0) {
+            ::close(mDirFd);
+            mDirFd = -1;
+        }
+    }
+
+    /// @brief Read a whole file of the opened process directory.
+    /// @return the content, valid until the next read
+    std::optional<std::string_view> read(char const* name) {
+        if (mDirFd < 0) {
+            return std::nullopt;
+        }
+        int fd = openat(mDirFd, name, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return std::nullopt;
+        }
+        size_t size(0);
+        while (true) {
+            if (size == mBuffer.size()) {
+                mBuffer.resize(mBuffer.size() * 2);
+            }
+            ssize_t const count = ::read(fd, mBuffer.data() + size, mBuffer.size() - size);
+            if (count < 0) {
+                ::close(fd);
+                return std::nullopt;
+            }
+            if (count == 0) {
+                break;
+            }
+            size += count;
+        }
+        ::close(fd);
+        return std::string_view(mBuffer.data(), size);
+    }
+
+private:
+    int mDirFd;
+    std::vector<char> mBuffer;
+};
+
+/// @brief Reads one procfs file like /proc/stat, kept open, with one pread into a buffer that is
+/// kept across reads. The buffer grows until the whole file fits.
+struct ProcFileReader {
+
+    explicit ProcFileReader(char const* location)
+        : mFd(::open(location, O_RDONLY | O_CLOEXEC)), mBuffer(4096){};
+
+    ~ProcFileReader() {
+        if (mFd >= 0) {
+            ::close(mFd);
+        }
+    }
+
+    ProcFileReader(ProcFileReader const&) = delete;
+    void operator=(ProcFileReader const&) = delete;
+
+    /// @return the content, valid until the next read
+    std::optional<std::string_view> read() {
+        if (mFd < 0) {
+            return std::nullopt;
+        }
+        while (true) {
+            ssize_t const count = pread(mFd, mBuffer.data(), mBuffer.size(), 0);
+            if (count < 0) {
+                return std::nullopt;
+            }
+            if (static_cast<size_t>(count) < mBuffer.size()) {
+                return std::string_view(mBuffer.data(), count);
+            }
+            // a full buffer may have cut the file off, read it again with more room
+            mBuffer.resize(mBuffer.size() * 2);
+        }
+    }
+
+private:
+    int mFd;
+    std::vector<char> mBuffer;
+};
+
+}  // namespace metrics
+
+#endif  // PROC_READER_H
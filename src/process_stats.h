@@ -11,23 +11,68 @@
 #ifndef PROCESS_STATS_H
 #define PROCESS_STATS_H
 
+#include <cpu_sample_cache.h>
+#include <cpu_stats.h>
+#include <key_value_parser.h>
+#include <proc_reader.h>
+#include <process_table.h>
+#include <uring_proc_reader.h>
 #include <utils/globals.h>
 
+#include <algorithm>
+#include <atomic>
+#include <charconv>
 #include <cstring>
 #include <map>
+#include <mutex>
+#include <numeric>
 #include <optional>
 #include <proc/readproc.h>
 #include <sys/resource.h>
+#include <thread>
 #include <tuple>
+#include <vector>
 
 namespace metrics {
 
+/// @brief Values collected for one process, only the fields found in procfs are set.
+struct ProcessSample {
+    int32_t pid = 0;
+    uint64_t utime = 0;
+    uint64_t stime = 0;
+    uint64_t startTime = 0;
+    uint64_t threadCount = 0;
+    std::optional<uint64_t> vmRss;
+    std::optional<uint64_t> rssFile;
+    std::optional<uint64_t> rssShmem;
+    std::optional<uint64_t> vmSize;
+    std::optional<uint64_t> voluntaryCtxSwitches;
+    std::optional<uint64_t> involuntaryCtxSwitches;
+    std::optional<uint64_t> fdSize;
+    std::optional<uint64_t> fdLimit;
+    std::optional<uint64_t> readCount;
+    std::optional<uint64_t> writeCount;
+    std::optional<uint64_t> readBytes;
+    std::optional<uint64_t> writeBytes;
+};
+
 struct ProcessStats {
-    using setFunction_t = const std::function<void(uint64_t,
-                                                   sysrepo::Session,
-                                                   std::optional<libyang::DataNode>&,
-                                                   std::string const&,
-                                                   int32_t)>;
+    enum class SortKey { Cpu, Rss, ReadKbytes, WriteKbytes, FdUsage };
+
+    /// @brief Fields of /proc/<pid>/status and /proc/<pid>/io, their keys do not overlap.
+    static constexpr KeyValueParser<ProcessSample, std::optional<uint64_t>, 11> kFields{{{
+        {"syscr", &ProcessSample::readCount},
+        {"syscw", &ProcessSample::writeCount},
+        {"read_bytes", &ProcessSample::readBytes},
+        {"write_bytes", &ProcessSample::writeBytes},
+        {"VmSize", &ProcessSample::vmSize},
+        {"VmRSS", &ProcessSample::vmRss},
+        {"RssFile", &ProcessSample::rssFile},
+        {"RssShmem", &ProcessSample::rssShmem},
+        {"voluntary_ctxt_switches", &ProcessSample::voluntaryCtxSwitches},
+        {"nonvoluntary_ctxt_switches", &ProcessSample::involuntaryCtxSwitches},
+        {"FDSize", &ProcessSample::fdSize},
+    }}};
 
     static ProcessStats& getInstance() {
         static ProcessStats instance;
@@ -37,82 +82,18 @@ struct ProcessStats {
     ProcessStats(ProcessStats const&) = delete;
     void operator=(ProcessStats const&) = delete;
 
-    static setFunction_t getSetFunction(std::string const& token) {
-        static std::unordered_map<std::string, setFunction_t> _{
-            {"syscr:",
-             [](uint64_t value, sysrepo::Session session, std::optional<libyang::DataNode>& parent,
-                std::string const& path, int32_t tid) {
-                 setXpath(session, parent, path + "/io/read-count", std::to_string(value));
-             }},
-            {"syscw:",
-             [](uint64_t value, sysrepo::Session session, std::optional<libyang::DataNode>& parent,
-                std::string const& path, int32_t tid) {
-                 setXpath(session, parent, path + "/io/write-count", std::to_string(value));
-             }},
-            {"read_bytes:",
-             [](uint64_t value, sysrepo::Session session, std::optional<libyang::DataNode>& parent,
-                std::string const& path, int32_t tid) {
-                 setXpath(session, parent, path + "/io/read-kbytes", std::to_string(value / 1024));
-             }},
-            {"write_bytes:",
-             [](uint64_t value, sysrepo::Session session, std::optional<libyang::DataNode>& parent,
-                std::string const& path, int32_t tid) {
-                 setXpath(session, parent, path + "/io/write-kbytes", std::to_string(value / 1024));
-             }},
-            {"voluntary_ctxt_switches:",
-             [](uint64_t value, sysrepo::Session session, std::optional<libyang::DataNode>& parent,
-                std::string const& path, int32_t tid) {
-                 setXpath(session, parent, path + "/voluntary-ctx-switches", std::to_string(value));
-             }},
-            {"nonvoluntary_ctxt_switches:",
-             [](uint64_t value, sysrepo::Session session, std::optional<libyang::DataNode>& parent,
-                std::string const& path, int32_t tid) {
-                 setXpath(session, parent, path + "/involuntary-ctx-switches",
-                          std::to_string(value));
-             }},
-            {"FDSize:",
-             [](uint64_t value, sysrepo::Session session, std::optional<libyang::DataNode>& parent,
-                std::string const& path, int32_t tid) {
-                 setXpath(session, parent, path + "/open-file-descriptors", std::to_string(value));
-                 struct rlimit maxFDs;
-                 if (!prlimit(tid, RLIMIT_NOFILE, nullptr, &maxFDs)) {
-                     std::stringstream stream;
-                     stream << std::fixed << std::setprecision(2)
-                            << value * 100.0 / static_cast<long double>(maxFDs.rlim_cur);
-                     setXpath(session, parent, path + "/open-file-descriptors-perc", stream.str());
-                 }
-             }}};
-        if (_.find(token) != _.end()) {
-            return _.at(token);
-        }
-        return nullptr;
-    }
-
-    static std::optional<size_t> getCpuTimes() {
-        std::ifstream proc_stat("/proc/stat");
-        proc_stat.ignore(5, ' ');  // Skip the 'cpu' prefix.
-        std::vector<size_t> cpu_times;
-        for (size_t time; proc_stat >> time; cpu_times.push_back(time))
-            ;
-        if (cpu_times.size() < 4)
+    std::optional<size_t> getCpuTimes() {
+        std::lock_guard lk(mStatMtx);
+        auto content(mStatReader.read());
+        if (!content) {
             return std::nullopt;
-        return accumulate(cpu_times.begin(), cpu_times.end(), 0);
-    }
-
-    static std::optional<std::tuple<size_t, size_t>> getProcessCpuTimes(int32_t tid) {
-        std::ifstream proc_stat("/proc/" + std::to_string(tid) + "/stat");
-        proc_stat.ignore(std::numeric_limits<std::streamsize>::max(), ')')
-            .ignore(2, ' ')
-            .ignore(2, ' ');
-        std::vector<size_t> proc_data;
-        for (size_t time; proc_stat >> time; proc_data.push_back(time))
-            ;
-        if (proc_data.size() < 12) {
+        }
+        CoreStats::Times times;
+        std::optional<uint32_t> core;
+        if (CoreStats::parseLine(content.value(), core, times) < 4 || core) {
             return std::nullopt;
         }
-        size_t utime = proc_data[10];
-        size_t stime = proc_data[11];
-        return std::make_tuple(utime, stime);
+        return std::accumulate(times.begin(), times.end(), size_t(0));
     }
 
     static double calculateCpuUsage(std::optional<size_t> total_time_before,
@@ -133,89 +114,496 @@ struct ProcessStats {
                         static_cast<double>(total_time_after.value() - total_time_before.value()));
     }
 
-    double getCpuUsage(int32_t tid) {
-        if (cached_cpu_values_.find(tid) != cached_cpu_values_.end()) {
-            auto const time_total_after = getCpuTimes();
-            auto const time_proc_after = getProcessCpuTimes(tid);
-            auto const [utime_after, stime_after] = time_proc_after.value();
+    /// @param time_total_after total cpu time sampled once for the whole sweep, so all processes
+    /// share the same denominator
+    double getCpuUsage(ProcessSample const& sample, std::optional<size_t> time_total_after) {
+        if (!time_total_after) {
+            return 0;
+        }
+        auto const previous = mCpuSamples.exchange(
+            sample.pid, sample.startTime, {time_total_after.value(), sample.utime, sample.stime});
+        if (!previous) {
+            return 0;
+        }
+        return calculateCpuUsage(previous->totalTime, time_total_after,
+                                 std::make_tuple(previous->utime, previous->stime),
+                                 std::make_tuple(sample.utime, sample.stime));
+    }
 
-            auto const [time_total_before, utime_before, stime_before] = cached_cpu_values_[tid];
-            auto const time_proc_before = std::make_tuple(utime_before, stime_before);
+    /// @brief Parse "key: value" lines of a procfs file into the sample.
+    static void parse(std::string_view content, ProcessSample& sample) {
+        kFields.parse(content, sample);
+    }
 
-            cached_cpu_values_[tid] =
-                std::make_tuple(time_total_after.value(), utime_after, stime_after);
+    /// @brief Parse the fields of /proc/<pid>/stat that are not in status, see proc(5).
+    static bool parseStat(std::string_view content, ProcessSample& sample) {
+        // the command name may contain spaces and parentheses, fields start after the last ')'
+        size_t const commEnd = content.rfind(')');
+        if (commEnd == std::string_view::npos) {
+            return false;
+        }
+        content.remove_prefix(commEnd + 1);
+        // field numbers of proc(5), starting with the state field 3
+        size_t field(2);
+        size_t found(0);
+        while (!content.empty() && found < 4) {
+            size_t const begin = content.find_first_not_of(' ');
+            if (begin == std::string_view::npos) {
+                break;
+            }
+            content.remove_prefix(begin);
+            size_t const end = std::min(content.find(' '), content.size());
+            field++;
+            uint64_t* target(nullptr);
+            switch (field) {
+            case 14:
+                target = &sample.utime;
+                break;
+            case 15:
+                target = &sample.stime;
+                break;
+            case 20:
+                target = &sample.threadCount;
+                break;
+            case 22:
+                target = &sample.startTime;
+                break;
+            default:
+                break;
+            }
+            if (target &&
+                std::from_chars(content.data(), content.data() + end, *target).ec == std::errc()) {
+                found++;
+            }
+            content.remove_prefix(end);
+        }
+        return found == 4;
+    }
 
-            return calculateCpuUsage(time_total_before, time_total_after, time_proc_before,
-                                     time_proc_after);
-        } else {
-            auto const time_total_before = getCpuTimes();
-            auto const time_proc_before = getProcessCpuTimes(tid);
-            cached_cpu_values_[tid] =
-                std::make_tuple(time_total_before.value(), std::get<0>(time_proc_before.value()),
-                                std::get<1>(time_proc_before.value()));
-            return 0;
+    /// @brief Read stat, status and io of a process, each file is opened and read once.
+    /// @return false if the process is gone
+    static bool read(ProcReader& reader, ProcessSample& sample) {
+        if (!reader.open(sample.pid)) {
+            return false;
+        }
+        auto const stat = reader.read("stat");
+        if (!stat || !parseStat(stat.value(), sample)) {
+            reader.close();
+            return false;
+        }
+        if (auto const content = reader.read("status")) {
+            parse(content.value(), sample);
         }
+        if (auto const content = reader.read("io")) {
+            parse(content.value(), sample);
+        }
+        reader.close();
+        readFdLimit(sample);
+        return true;
     }
 
-    void readAndSet(sysrepo::Session session,
-                    std::optional<libyang::DataNode>& parent,
-                    int32_t tid,
-                    std::string const& procXpath,
-                    std::string const& what) {
-        std::string token;
-        std::ifstream file("/proc/" + std::to_string(tid) + "/" + what);
-        while (file >> token) {
-            auto const& func = getSetFunction(token);
-            if (func) {
-                uint64_t value;
-                if (file >> value) {
-                    func(value, session, parent, procXpath, tid);
-                }
-            }
-            // ignore rest of the line
-            file.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    static void readFdLimit(ProcessSample& sample) {
+        struct rlimit maxFDs;
+        if (sample.fdSize && !prlimit(sample.pid, RLIMIT_NOFILE, nullptr, &maxFDs)) {
+            sample.fdLimit = maxFDs.rlim_cur;
         }
     }
 
-    void readAndSetAll(sysrepo::Session session,
-                       std::optional<libyang::DataNode>& parent,
-                       std::string_view moduleName) {
-        PROCTAB* proc = openproc(PROC_FILLMEM | PROC_FILLSTAT | PROC_FILLSTATUS);
+    /// @brief Read a batch of processes through io_uring, files that do not fit the ring buffers
+    /// are read again with the reader.
+    /// @return false if the ring failed, the batch has to be read without it then
+    static bool readBatch(UringProcReader& uring,
+                          ProcReader& reader,
+                          int32_t const* pids,
+                          size_t count,
+                          std::vector<ProcessSample>& samples) {
+        static char const* const kNames[UringProcReader::FileCount] = {"stat", "status", "io"};
+        std::vector<ProcessSample> batch(count);
+        std::vector<bool> alive(count, false);
+        for (size_t i = 0; i < count; i++) {
+            batch[i].pid = pids[i];
+        }
+        auto const onFile = [&](size_t i, UringProcReader::File file,
+                                std::optional<std::string_view> content) {
+            if (!content && reader.open(pids[i])) {
+                content = reader.read(kNames[file]);
+            }
+            if (!content) {
+                return;
+            }
+            if (file == UringProcReader::Stat) {
+                alive[i] = parseStat(content.value(), batch[i]);
+            } else {
+                parse(content.value(), batch[i]);
+            }
+        };
+        bool const ok = uring.readBatch(pids, count, onFile);
+        reader.close();
+        if (!ok) {
+            return false;
+        }
+        for (size_t i = 0; i < count; i++) {
+            if (alive[i]) {
+                readFdLimit(batch[i]);
+                samples.push_back(std::move(batch[i]));
+            }
+        }
+        return true;
+    }
 
+    /// @brief Enumerate the processes, libprocps is not thread safe so this stays on the
+    /// calling thread and only reads the /proc directory.
+    static std::vector<int32_t> listPids() {
+        std::vector<int32_t> pids;
+        PROCTAB* proc = openproc(0);
+        if (!proc) {
+            logMessage(SR_LL_ERR, "openproc call failed");
+            return pids;
+        }
         proc_t procInfo;
         memset(&procInfo, 0, sizeof(procInfo));
-        std::string const baseXpath("/" + std::string(moduleName) +
-                                    ":system-metrics/processes/process[pid='");
         while (readproc(proc, &procInfo) != NULL) {
-            std::string const procXpath(baseXpath + std::to_string(procInfo.tid) + "']");
-            // memory stats
-            setXpath(session, parent, procXpath + "/memory/real",
-                     std::to_string(procInfo.vm_rss - procInfo.vm_rss_shared));
-            setXpath(session, parent, procXpath + "/memory/rss", std::to_string(procInfo.vm_rss));
-            setXpath(session, parent, procXpath + "/memory/vsz", std::to_string(procInfo.vm_size));
+            pids.push_back(procInfo.tid);
+        }
+        closeproc(proc);
+        return pids;
+    }
 
-            // io
-            readAndSet(session, parent, procInfo.tid, procXpath, "io");
-            readAndSet(session, parent, procInfo.tid, procXpath, "status");
+    /// @brief PID from a process[pid='N'] key predicate, if the predicate selects exactly that.
+    static std::optional<int32_t> predicatePid(std::string_view path) {
+        static constexpr std::string_view kList("process[");
+        size_t list(0);
+        while ((list = path.find(kList, list)) != std::string_view::npos) {
+            if (list > 0 && (path[list - 1] == '/' || path[list - 1] == ':')) {
+                break;
+            }
+            list++;
+        }
+        if (list == std::string_view::npos) {
+            return std::nullopt;
+        }
+        path.remove_prefix(list + kList.size());
 
-            // nlwp
-            setXpath(session, parent, procXpath + "/thread-count", std::to_string(procInfo.nlwp));
+        size_t pos = path.find_first_not_of(' ');
+        if (pos == std::string_view::npos || path.substr(pos, 3) != "pid") {
+            return std::nullopt;
+        }
+        pos = path.find_first_not_of(' ', pos + 3);
+        if (pos == std::string_view::npos || path[pos] != '=') {
+            return std::nullopt;
+        }
+        pos = path.find_first_not_of(' ', pos + 1);
+        if (pos == std::string_view::npos) {
+            return std::nullopt;
+        }
+        char const quote(path[pos] == '\'' || path[pos] == '"' ? path[pos] : '\0');
+        if (quote) {
+            pos++;
+        }
+        int32_t pid;
+        auto const [ptr, ec] = std::from_chars(path.data() + pos, path.data() + path.size(), pid);
+        if (ec != std::errc() || pid <= 0) {
+            return std::nullopt;
+        }
+        pos = ptr - path.data();
+        if (quote) {
+            if (pos >= path.size() || path[pos] != quote) {
+                return std::nullopt;
+            }
+            pos++;
+        }
+        pos = path.find_first_not_of(' ', pos);
+        if (pos == std::string_view::npos || path[pos] != ']') {
+            return std::nullopt;
+        }
+        return pid;
+    }
 
-            // cpu
-            std::stringstream stream;
-            stream << std::fixed << std::setprecision(2) << getCpuUsage(procInfo.tid);
-            setXpath(session, parent, procXpath + "/cpu", stream.str());
+    /// @brief PIDs selected by the key predicates of a request xpath, e.g.
+    /// /os-metrics:system-metrics/processes/process[pid='1234'] or a union of such paths.
+    /// @return nullopt if any part of the request is not restricted to one PID
+    static std::optional<std::vector<int32_t>>
+    requestedPids(std::optional<std::string_view> requestXPath) {
+        if (!requestXPath) {
+            return std::nullopt;
+        }
+        std::vector<int32_t> pids;
+        std::string_view xpath(requestXPath.value());
+        while (true) {
+            size_t const bar = xpath.find('|');
+            auto const pid = predicatePid(xpath.substr(0, bar));
+            if (!pid) {
+                return std::nullopt;
+            }
+            pids.push_back(pid.value());
+            if (bar == std::string_view::npos) {
+                break;
+            }
+            xpath.remove_prefix(bar + 1);
         }
+        std::sort(pids.begin(), pids.end());
+        pids.erase(std::unique(pids.begin(), pids.end()), pids.end());
+        return pids;
+    }
 
-        closeproc(proc);
+    void collect(std::vector<int32_t>::const_iterator begin,
+                 std::vector<int32_t>::const_iterator end,
+                 std::vector<ProcessSample>& samples) {
+        ProcReader reader;
+        samples.reserve(end - begin);
+        auto itr = begin;
+        // a few processes are read directly, they would only tie up a ring
+        std::unique_ptr<UringProcReader> uring;
+        if (static_cast<size_t>(end - begin) >= kMinShardSize) {
+            uring = mUringReaders.acquire();
+        }
+        while (uring && uring->available() && itr != end) {
+            size_t const count(std::min<size_t>(end - itr, UringProcReader::kBatchSize));
+            if (!readBatch(*uring, reader, &*itr, count, samples)) {
+                logMessage(SR_LL_WRN, "io_uring process collection failed, reading directly");
+                break;
+            }
+            itr += count;
+        }
+        mUringReaders.release(std::move(uring), mWorkerThreads);
+        for (; itr != end; ++itr) {
+            ProcessSample sample;
+            sample.pid = *itr;
+            if (read(reader, sample)) {
+                samples.push_back(std::move(sample));
+            }
+        }
+    }
+
+    /// @brief Collect the processes split into contiguous shards, each shard on its own worker
+    /// thread into its own buffer. The calling thread collects the first shard.
+    std::vector<std::vector<ProcessSample>> collectAll(std::vector<int32_t> const& pids) {
+        size_t const shardCount(std::clamp<size_t>(pids.size() / kMinShardSize, 1,
+                                                   std::max<uint32_t>(mWorkerThreads, 1)));
+        size_t const shardSize((pids.size() + shardCount - 1) / shardCount);
+        std::vector<std::vector<ProcessSample>> shards(shardCount);
+        std::vector<std::thread> workers;
+        for (size_t i = 1; i < shardCount; i++) {
+            auto const begin = pids.begin() + std::min(i * shardSize, pids.size());
+            auto const end = pids.begin() + std::min((i + 1) * shardSize, pids.size());
+            workers.emplace_back(&ProcessStats::collect, this, begin, end, std::ref(shards[i]));
+        }
+        collect(pids.begin(), pids.begin() + std::min(shardSize, pids.size()), shards[0]);
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        return shards;
     }
 
-    /// @brief Cached cpu usage value used where sigar is not present
-    /// values are total_cpu_time, proc_user_time, proc_sys_time
-    std::unordered_map<int32_t, std::tuple<size_t, size_t, size_t>> cached_cpu_values_;
+    static std::optional<SortKey> sortKeyFromString(std::string const& name) {
+        static std::unordered_map<std::string, SortKey> const _{
+            {"cpu", SortKey::Cpu},
+            {"rss", SortKey::Rss},
+            {"read-kbytes", SortKey::ReadKbytes},
+            {"write-kbytes", SortKey::WriteKbytes},
+            {"fd-usage", SortKey::FdUsage}};
+        auto const itr = _.find(name);
+        if (itr == _.end()) {
+            return std::nullopt;
+        }
+        return itr->second;
+    }
+
+    static double rankOf(ProcessSample const& sample, double cpu, SortKey sortKey) {
+        switch (sortKey) {
+        case SortKey::Cpu:
+            return cpu;
+        case SortKey::Rss:
+            return sample.vmRss.value_or(0);
+        case SortKey::ReadKbytes:
+            return sample.readBytes.value_or(0);
+        case SortKey::WriteKbytes:
+            return sample.writeBytes.value_or(0);
+        case SortKey::FdUsage:
+            if (sample.fdSize && sample.fdLimit) {
+                return sample.fdSize.value() / static_cast<double>(sample.fdLimit.value());
+            }
+            return 0;
+        }
+        return 0;
+    }
+
+    /// @param topN number of processes reported, 0 reports all
+    void setTopN(uint32_t topN, SortKey sortKey) {
+        logMessage(SR_LL_DBG, "Process collection top-n: ", topN);
+        std::lock_guard lk(mMtx);
+        mTopN = topN;
+        mSortKey = sortKey;
+    }
+
+    void setWorkerThreads(uint32_t workerThreads) {
+        logMessage(SR_LL_DBG, "Process collection worker threads: ", workerThreads);
+        mWorkerThreads = workerThreads;
+    }
+
+    void setXpathValues(sysrepo::Session session,
+                        std::optional<libyang::DataNode>& parent,
+                        char const* procXpath,
+                        ProcessSample const& sample,
+                        double cpu) {
+        // the list entry is resolved once, its leaves are added relative to it
+        lyd_node* entry(createXpath(session, parent, procXpath));
+        if (!entry) {
+            return;
+        }
+
+        // memory stats
+        if (sample.vmRss) {
+            uint64_t const shared(sample.rssFile.value_or(0) + sample.rssShmem.value_or(0));
+            setXpath(entry, "memory/real", sample.vmRss.value() - shared);
+            setXpath(entry, "memory/rss", sample.vmRss.value());
+        }
+        if (sample.vmSize) {
+            setXpath(entry, "memory/vsz", sample.vmSize.value());
+        }
+
+        // io
+        if (sample.readCount) {
+            setXpath(entry, "io/read-count", sample.readCount.value());
+        }
+        if (sample.writeCount) {
+            setXpath(entry, "io/write-count", sample.writeCount.value());
+        }
+        if (sample.readBytes) {
+            setXpath(entry, "io/read-kbytes", sample.readBytes.value() / 1024);
+        }
+        if (sample.writeBytes) {
+            setXpath(entry, "io/write-kbytes", sample.writeBytes.value() / 1024);
+        }
+
+        // status
+        if (sample.voluntaryCtxSwitches) {
+            setXpath(entry, "voluntary-ctx-switches", sample.voluntaryCtxSwitches.value());
+        }
+        if (sample.involuntaryCtxSwitches) {
+            setXpath(entry, "involuntary-ctx-switches", sample.involuntaryCtxSwitches.value());
+        }
+        if (sample.fdSize) {
+            setXpath(entry, "open-file-descriptors", sample.fdSize.value());
+        }
+        if (sample.fdSize && sample.fdLimit) {
+            setPercentXpath(entry, "open-file-descriptors-perc",
+                            sample.fdSize.value() * 100.0 /
+                                static_cast<double>(sample.fdLimit.value()));
+        }
+
+        // nlwp
+        setXpath(entry, "thread-count", sample.threadCount);
+
+        // cpu
+        setPercentXpath(entry, "cpu", cpu);
+    }
+
+    void readAndSetAll(sysrepo::Session session,
+                       std::optional<libyang::DataNode>& parent,
+                       std::string_view moduleName,
+                       std::optional<std::string_view> requestXPath,
+                       XpathArena& arena) {
+        std::optional<size_t> const totalCpuTime(getCpuTimes());
+        // requests for specific processes read only those, straight from /proc/<pid>
+        auto const requested(requestedPids(requestXPath));
+        // the live process table replaces the /proc scan and tells which processes exited
+        std::optional<ProcessTable::Snapshot> live;
+        std::vector<int32_t> pids;
+        if (requested) {
+            pids = requested.value();
+        } else if ((live = mProcessTable.snapshot(&ProcessStats::listPids))) {
+            pids.swap(live->pids);
+        } else {
+            pids = listPids();
+        }
+        auto const shards(collectAll(pids));
+
+        // the libyang tree and the cpu sample cache are only touched from the callback thread
+        std::lock_guard lk(mMtx);
+        // exited processes are evicted exactly if the table saw all exits, otherwise a full
+        // sweep evicts what it did not see. A partial sweep must not evict the samples of the
+        // processes that were not requested.
+        bool const sweep(!requested && !(live && live->exact));
+        if (live && live->exact) {
+            mCpuSamples.evict(std::move(live->exited));
+        }
+        if (sweep) {
+            mCpuSamples.beginSweep();
+        }
+        auto const baseXpath(
+            arena.concat({"/", moduleName, ":system-metrics/processes/process[pid='"}));
+        auto const setProcess = [&](ProcessSample const& sample, double cpu) {
+            char pid[16];
+            auto const end = std::to_chars(pid, pid + sizeof(pid), sample.pid).ptr;
+            auto const procXpath(arena.concat({baseXpath, std::string_view(pid, end - pid), "']"}));
+            setXpathValues(session, parent, procXpath.c_str(), sample, cpu);
+        };
+
+        // in top-n mode every sample still updates the cpu cache, but only the n highest
+        // ranking ones are kept in a min-heap and end up in the tree
+        struct Ranked {
+            double rank;
+            double cpu;
+            ProcessSample const* sample;
+        };
+        auto const lowerRank = [](Ranked const& a, Ranked const& b) { return a.rank > b.rank; };
+        size_t const topN(requested ? 0 : mTopN);
+        size_t collected(0);
+        for (auto const& samples : shards) {
+            collected += samples.size();
+        }
+        // top-n is configured up to the type maximum, do not reserve more than there is
+        std::vector<Ranked> heap;
+        heap.reserve(std::min(topN, collected));
+        for (auto const& samples : shards) {
+            for (auto const& sample : samples) {
+                double const cpu(getCpuUsage(sample, totalCpuTime));
+                if (!topN) {
+                    setProcess(sample, cpu);
+                    continue;
+                }
+                Ranked const ranked{rankOf(sample, cpu, mSortKey), cpu, &sample};
+                if (heap.size() < topN) {
+                    heap.push_back(ranked);
+                    std::push_heap(heap.begin(), heap.end(), lowerRank);
+                } else if (ranked.rank > heap.front().rank) {
+                    std::pop_heap(heap.begin(), heap.end(), lowerRank);
+                    heap.back() = ranked;
+                    std::push_heap(heap.begin(), heap.end(), lowerRank);
+                }
+            }
+        }
+        std::sort_heap(heap.begin(), heap.end(), lowerRank);
+        for (auto const& ranked : heap) {
+            setProcess(*ranked.sample, ranked.cpu);
+        }
+        if (sweep) {
+            mCpuSamples.endSweep();
+        }
+    }
 
 private:
-    ProcessStats() = default;
+    static constexpr size_t kMinShardSize = 64;
+
+    ProcessStats()
+        : mWorkerThreads(1), mTopN(0), mSortKey(SortKey::Cpu), mStatReader(CpuStats::kLocation){};
+
+    std::atomic<uint32_t> mWorkerThreads;
+    std::mutex mMtx;
+    uint32_t mTopN;
+    SortKey mSortKey;
+
+    /// @brief Cpu times of the previous sweep
+    CpuSampleCache mCpuSamples;
+
+    ProcessTable mProcessTable;
+
+    /// @brief At most one per worker thread is kept between requests
+    UringProcReaderPool mUringReaders;
+
+    std::mutex mStatMtx;
+    ProcFileReader mStatReader;
 };
 
 }  // namespace metrics
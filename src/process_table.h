@@ -0,0 +1,276 @@
+// telekom / sysrepo-plugin-os-metrics
+//
+// This program is made available under the terms of the
+// BSD 3-Clause license which is available at
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// SPDX-FileCopyrightText: 2022 Deutsche Telekom AG
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef PROCESS_TABLE_H
+#define PROCESS_TABLE_H
+
+#include <utils/globals.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <linux/cn_proc.h>
+#include <linux/connector.h>
+#include <linux/netlink.h>
+#include <mutex>
+#include <optional>
+#include <poll.h>
+#include <string>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <unordered_set>
+#include <vector>
+
+namespace metrics {
+
+/// @brief Live set of processes kept up to date by fork, exec and exit events of the netlink
+/// proc connector. It needs CAP_NET_ADMIN in the initial pid namespace, otherwise it stays
+/// unavailable. The subscription is made by its thread, until the kernel acknowledged it the
+/// table is unavailable too. After dropped events the set is rebuilt from a scan on the next
+/// snapshot.
+struct ProcessTable {
+    /// @brief Pending exits are only kept up to this count, beyond it the exits are reported
+    /// as inexact and the caller has to find out itself which processes are gone.
+    static constexpr size_t kMaxPendingExits = 65536;
+    static constexpr int kAckTimeoutMs = 1000;
+    static constexpr int kReceiveBufferSize = 4 * 1024 * 1024;
+
+    struct Snapshot {
+        std::vector<int32_t> pids;
+        std::vector<int32_t> exited;  // processes that exited since the previous snapshot
+        bool exact;                   // false if exited is incomplete
+    };
+
+    ProcessTable()
+        : mSocket(-1), mWakeFd(eventfd(0, EFD_CLOEXEC)), mResync(true), mExitsOverflowed(false),
+          mReady(false), mDead(false) {
+        if (mWakeFd < 0) {
+            logMessage(SR_LL_WRN, "Proc connector eventfd failed, processes are scanned");
+            return;
+        }
+        // waiting for the acknowledgement would delay the plugin init by up to kAckTimeoutMs
+        mThread = std::thread(&ProcessTable::runFunc, this);
+    }
+
+    ~ProcessTable() {
+        if (mThread.joinable()) {
+            uint64_t const one(1);
+            if (write(mWakeFd, &one, sizeof(one)) != sizeof(one)) {
+                logMessage(SR_LL_ERR, "Waking the proc connector thread failed");
+            }
+            mThread.join();
+        }
+        closeFds();
+    }
+
+    ProcessTable(ProcessTable const&) = delete;
+    void operator=(ProcessTable const&) = delete;
+
+    /// @return false if the connector is not subscribed yet, never started or its thread gave
+    /// up, the caller scans
+    bool available() const {
+        return mReady && !mDead;
+    }
+
+    /// @brief Current processes. Rebuilt with the scan function after dropped events, events
+    /// are held back while it runs so none gets lost between the scan and the table.
+    /// @return nullopt if the connector is not available
+    template <typename F>
+    std::optional<Snapshot> snapshot(F&& scan) {
+        if (!available()) {
+            return std::nullopt;
+        }
+        std::lock_guard lk(mMtx);
+        Snapshot snapshot;
+        snapshot.exact = !mResync && !mExitsOverflowed;
+        if (mResync) {
+            auto const pids(scan());
+            mPids = std::unordered_set<int32_t>(pids.begin(), pids.end());
+            mResync = false;
+        }
+        snapshot.pids.assign(mPids.begin(), mPids.end());
+        snapshot.exited.swap(mExited);
+        mExitsOverflowed = false;
+        return snapshot;
+    }
+
+private:
+    /// @return false if the connector is not available or the table is destroyed meanwhile
+    bool subscribe() {
+        mSocket = socket(PF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_CONNECTOR);
+        if (mSocket < 0) {
+            logMessage(SR_LL_WRN, "Proc connector socket failed, processes are scanned");
+            return false;
+        }
+        int const bufferSize(kReceiveBufferSize);
+        setsockopt(mSocket, SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof(bufferSize));
+
+        struct sockaddr_nl address;
+        memset(&address, 0, sizeof(address));
+        address.nl_family = AF_NETLINK;
+        address.nl_groups = CN_IDX_PROC;
+        address.nl_pid = 0;  // assigned by the kernel
+        if (bind(mSocket, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) < 0) {
+            logMessage(SR_LL_WRN, "Proc connector bind failed, processes are scanned");
+            return false;
+        }
+
+        alignas(struct nlmsghdr) char buffer[NLMSG_SPACE(sizeof(struct cn_msg) +
+                                                         sizeof(enum proc_cn_mcast_op))];
+        memset(buffer, 0, sizeof(buffer));
+        struct nlmsghdr* header = reinterpret_cast<struct nlmsghdr*>(buffer);
+        header->nlmsg_len = sizeof(buffer);
+        header->nlmsg_type = NLMSG_DONE;
+        struct cn_msg* message = reinterpret_cast<struct cn_msg*>(NLMSG_DATA(header));
+        message->id.idx = CN_IDX_PROC;
+        message->id.val = CN_VAL_PROC;
+        message->len = sizeof(enum proc_cn_mcast_op);
+        *reinterpret_cast<enum proc_cn_mcast_op*>(message->data) = PROC_CN_MCAST_LISTEN;
+        if (send(mSocket, buffer, sizeof(buffer), 0) < 0) {
+            logMessage(SR_LL_WRN, "Proc connector subscription failed, processes are scanned");
+            return false;
+        }
+
+        // the kernel acknowledges the subscription, except outside of the initial namespaces
+        // where it silently sends no events at all
+        struct pollfd pfds[2] = {{mSocket, POLLIN, 0}, {mWakeFd, POLLIN, 0}};
+        while (poll(pfds, 2, kAckTimeoutMs) > 0) {
+            if (pfds[1].revents) {
+                return false;
+            }
+            std::optional<int> ack;
+            receive([&ack](struct proc_event const& event) {
+                if (event.what == proc_event::PROC_EVENT_NONE) {
+                    ack = event.event_data.ack.err;
+                }
+            });
+            if (ack) {
+                if (ack.value() != 0) {
+                    logMessage(SR_LL_WRN, "Proc connector subscription rejected: ",
+                               strerror(ack.value()));
+                    return false;
+                }
+                return true;
+            }
+        }
+        logMessage(SR_LL_WRN, "Proc connector not acknowledged, processes are scanned");
+        return false;
+    }
+
+    void closeFds() {
+        if (mSocket >= 0) {
+            close(mSocket);
+            mSocket = -1;
+        }
+        if (mWakeFd >= 0) {
+            close(mWakeFd);
+            mWakeFd = -1;
+        }
+    }
+
+    /// @brief Receive one datagram and pass its events on.
+    /// @return false on ENOBUFS, events were dropped then
+    template <typename F>
+    bool receive(F&& onEvent) {
+        alignas(struct nlmsghdr) char buffer[8192];
+        ssize_t length = recv(mSocket, buffer, sizeof(buffer), 0);
+        if (length < 0) {
+            return errno != ENOBUFS;
+        }
+        for (struct nlmsghdr* header = reinterpret_cast<struct nlmsghdr*>(buffer);
+             NLMSG_OK(header, length); header = NLMSG_NEXT(header, length)) {
+            if (header->nlmsg_type == NLMSG_ERROR || header->nlmsg_type == NLMSG_NOOP) {
+                continue;
+            }
+            struct cn_msg const* message = reinterpret_cast<struct cn_msg*>(NLMSG_DATA(header));
+            if (message->id.idx != CN_IDX_PROC || message->id.val != CN_VAL_PROC) {
+                continue;
+            }
+            // the event follows the 20 byte cn_msg header unaligned, copy it out
+            struct proc_event event;
+            memset(&event, 0, sizeof(event));
+            memcpy(&event, message->data, std::min<size_t>(message->len, sizeof(event)));
+            onEvent(event);
+        }
+        return true;
+    }
+
+    void apply(struct proc_event const& event) {
+        switch (event.what) {
+        case proc_event::PROC_EVENT_FORK:
+            // new threads share the tgid of their process
+            if (event.event_data.fork.child_pid == event.event_data.fork.child_tgid) {
+                mPids.insert(event.event_data.fork.child_tgid);
+            }
+            break;
+        case proc_event::PROC_EVENT_EXEC:
+            mPids.insert(event.event_data.exec.process_tgid);
+            break;
+        case proc_event::PROC_EVENT_EXIT:
+            if (event.event_data.exit.process_pid == event.event_data.exit.process_tgid) {
+                mPids.erase(event.event_data.exit.process_tgid);
+                if (mExited.size() < kMaxPendingExits) {
+                    mExited.push_back(event.event_data.exit.process_tgid);
+                } else {
+                    mExitsOverflowed = true;
+                }
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    void runFunc() {
+        if (!subscribe()) {
+            mDead = true;
+            return;
+        }
+        mReady = true;
+        struct pollfd pfds[2] = {{mSocket, POLLIN, 0}, {mWakeFd, POLLIN, 0}};
+        while (true) {
+            if (poll(pfds, 2, -1) < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                logMessage(SR_LL_ERR, "Proc connector poll failed: ", strerror(errno));
+                break;
+            }
+            if (pfds[1].revents) {
+                break;
+            }
+            std::lock_guard lk(mMtx);
+            if (!receive([this](struct proc_event const& event) { apply(event); })) {
+                logMessage(SR_LL_WRN, "Proc connector dropped events, processes are rescanned");
+                mResync = true;
+            }
+        }
+        // without events the table goes stale, fall back to scanning from now on
+        mDead = true;
+    }
+
+    int mSocket;
+    int mWakeFd;
+    std::mutex mMtx;
+    std::unordered_set<int32_t> mPids;
+    std::vector<int32_t> mExited;
+    bool mResync;
+    bool mExitsOverflowed;
+    std::atomic<bool> mReady;
+    std::atomic<bool> mDead;
+    std::thread mThread;
+};
+
+}  // namespace metrics
+
+#endif  // PROCESS_TABLE_H
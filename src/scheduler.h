@@ -0,0 +1,199 @@
+// telekom / sysrepo-plugin-os-metrics
+//
+// This program is made available under the terms of the
+// BSD 3-Clause license which is available at
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// SPDX-FileCopyrightText: 2022 Deutsche Telekom AG
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <utils/globals.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace metrics {
+
+/// @brief Single thread running all periodic checks from a min-heap of due times.
+/// Due times are aligned to multiples of the interval since the scheduler started, so checks
+/// whose intervals line up are run in the same wakeup. Tasks that have to run on time, next to
+/// checks that can block, get a scheduler of their own.
+struct Scheduler {
+    using Clock = std::chrono::steady_clock;
+    using task_t = std::function<void()>;
+
+    /// @brief The scheduler shared by the threshold checks
+    static Scheduler& getInstance() {
+        static Scheduler instance;
+        return instance;
+    }
+
+    Scheduler() : mEpoch(Clock::now()), mGeneration(0), mStop(false), mRunning(nullptr){};
+
+    Scheduler(Scheduler const&) = delete;
+    void operator=(Scheduler const&) = delete;
+
+    ~Scheduler() {
+        {
+            std::lock_guard lk(mMtx);
+            mStop = true;
+        }
+        mCV.notify_all();
+        if (mThread.joinable()) {
+            mThread.join();
+        }
+    }
+
+    /// @brief Run task every interval, replacing the task previously scheduled under key.
+    void schedule(std::string const& key, std::chrono::milliseconds interval, task_t task) {
+        if (interval.count() <= 0) {
+            logMessage(SR_LL_WRN, "Invalid interval for: ", key);
+            return;
+        }
+        std::lock_guard lk(mMtx);
+        Task& entry = mTasks[key];
+        entry.interval = interval;
+        entry.task = std::move(task);
+        entry.generation = ++mGeneration;
+        mHeap.push(Due{nextDue(Clock::now(), interval), key, entry.generation});
+        if (!mThread.joinable()) {
+            mThread = std::thread(&Scheduler::runFunc, this);
+        }
+        mCV.notify_all();
+    }
+
+    /// @brief Remove the task under key. A run of it that already started is waited for, so
+    /// the task can no longer be running once this returns, unless called from the task itself.
+    /// The caller must not hold a lock the task takes.
+    void cancel(std::string const& key) {
+        std::unique_lock lk(mMtx);
+        // stale heap entries are dropped when they become due
+        mTasks.erase(key);
+        waitUntilNotRunning(lk, [&key](std::string const& running) { return running == key; });
+    }
+
+    void cancelPrefix(std::string const& prefix) {
+        std::unique_lock lk(mMtx);
+        auto const matches = [&prefix](std::string const& key) {
+            return key.compare(0, prefix.size(), prefix) == 0;
+        };
+        for (auto itr = mTasks.begin(); itr != mTasks.end();) {
+            if (matches(itr->first)) {
+                itr = mTasks.erase(itr);
+            } else {
+                ++itr;
+            }
+        }
+        waitUntilNotRunning(lk, matches);
+    }
+
+    bool isScheduled(std::string const& key) {
+        std::lock_guard lk(mMtx);
+        return mTasks.find(key) != mTasks.end();
+    }
+
+private:
+    struct Task {
+        std::chrono::milliseconds interval;
+        task_t task;
+        uint64_t generation;
+    };
+
+    struct Due {
+        Clock::time_point when;
+        std::string key;
+        uint64_t generation;
+
+        bool operator>(Due const& other) const {
+            return when > other.when;
+        }
+    };
+
+    /// @brief First multiple of interval since the epoch that is later than now.
+    Clock::time_point nextDue(Clock::time_point now, std::chrono::milliseconds interval) const {
+        auto const elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - mEpoch);
+        return mEpoch + (elapsed / interval + 1) * interval;
+    }
+
+    /// @brief Wait while the running task matches, the scheduler thread cannot wait for itself.
+    template <typename Matches>
+    void waitUntilNotRunning(std::unique_lock<std::mutex>& lk, Matches&& matches) {
+        if (std::this_thread::get_id() == mThread.get_id()) {
+            return;
+        }
+        mDoneCV.wait(lk, [&] { return !mRunning || !matches(*mRunning); });
+    }
+
+    void runFunc() {
+        std::unique_lock lk(mMtx);
+        while (!mStop) {
+            if (mHeap.empty()) {
+                mCV.wait(lk);
+                continue;
+            }
+            // copy, the heap may be reallocated while waiting
+            Clock::time_point const when = mHeap.top().when;
+            if (mCV.wait_until(lk, when) == std::cv_status::no_timeout) {
+                continue;
+            }
+            auto const now = Clock::now();
+            std::vector<std::pair<Due, task_t>> due;
+            while (!mHeap.empty() && mHeap.top().when <= now) {
+                Due entry = mHeap.top();
+                mHeap.pop();
+                auto const itr = mTasks.find(entry.key);
+                if (itr != mTasks.end() && itr->second.generation == entry.generation) {
+                    due.emplace_back(std::move(entry), itr->second.task);
+                }
+            }
+
+            for (auto const& [entry, task] : due) {
+                // it may have been cancelled while an earlier task of this wakeup ran
+                auto const itr = mTasks.find(entry.key);
+                if (itr == mTasks.end() || itr->second.generation != entry.generation) {
+                    continue;
+                }
+                mRunning = &entry.key;
+                lk.unlock();
+                task();
+                lk.lock();
+                mRunning = nullptr;
+                mDoneCV.notify_all();
+            }
+
+            for (auto& [entry, _] : due) {
+                auto const itr = mTasks.find(entry.key);
+                if (itr != mTasks.end() && itr->second.generation == entry.generation) {
+                    entry.when = nextDue(Clock::now(), itr->second.interval);
+                    mHeap.push(std::move(entry));
+                }
+            }
+        }
+    }
+
+    Clock::time_point const mEpoch;
+    uint64_t mGeneration;
+    bool mStop;
+    std::string const* mRunning;  // key of the task being run
+    std::unordered_map<std::string, Task> mTasks;
+    std::priority_queue<Due, std::vector<Due>, std::greater<Due>> mHeap;
+    std::mutex mMtx;
+    std::condition_variable mCV;
+    std::condition_variable mDoneCV;
+    std::thread mThread;
+};
+
+}  // namespace metrics
+
+#endif  // SCHEDULER_H
@@ -0,0 +1,170 @@
+// telekom / sysrepo-plugin-os-metrics
+//
+// This program is made available under the terms of the
+// BSD 3-Clause license which is available at
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// SPDX-FileCopyrightText: 2022 Deutsche Telekom AG
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef STATVFS_PROBER_H
+#define STATVFS_PROBER_H
+
+#include <utils/globals.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <sys/statvfs.h>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+namespace metrics {
+
+/// @brief Runs statvfs calls on a small pool of worker threads so that a hung NFS/FUSE mount
+/// can only delay a query up to a deadline instead of blocking it forever. Every mount point
+/// of a probe starts right away on a worker of its own, a worker stuck on a hung mount never
+/// holds up the others.
+struct StatvfsProber {
+    using StatFunction = int (*)(char const*, struct statvfs*);
+
+    enum class Status { Ok, Failed, TimedOut };
+
+    struct Result {
+        Status status = Status::TimedOut;
+        struct statvfs buf;
+    };
+
+    static constexpr std::chrono::milliseconds kDeadline{2000};
+    /// @brief Idle workers kept for the next probe
+    static constexpr size_t kMaxWorkers = 8;
+    /// @brief Ceiling on all workers, including the ones stuck on hung mounts
+    static constexpr size_t kMaxThreads = 64;
+
+    static StatvfsProber& getInstance() {
+        static StatvfsProber instance;
+        return instance;
+    }
+
+    /// @param stat the call probing a mount point, replaced in tests
+    explicit StatvfsProber(StatFunction stat = ::statvfs) : mPool(std::make_shared<Pool>()) {
+        mPool->stat = stat;
+    }
+
+    StatvfsProber(StatvfsProber const&) = delete;
+    void operator=(StatvfsProber const&) = delete;
+
+    ~StatvfsProber() {
+        std::lock_guard lk(mPool->mtx);
+        mPool->stop = true;
+        mPool->cv.notify_all();
+    }
+
+    /// @brief Probe all mount points in parallel. Mount points that did not answer before the
+    /// deadline, or whose previous probe is still hanging, are reported as TimedOut.
+    std::vector<Result> probe(std::vector<std::string> const& mountPoints,
+                              std::chrono::milliseconds deadline = kDeadline) {
+        auto batch = std::make_shared<Batch>();
+        batch->results.resize(mountPoints.size());
+        {
+            std::lock_guard lk(mPool->mtx);
+            for (size_t i = 0; i < mountPoints.size(); i++) {
+                if (!mPool->inFlight.insert(mountPoints[i]).second) {
+                    logMessage(SR_LL_WRN, "statvfs still pending for: ", mountPoints[i]);
+                    continue;
+                }
+                mPool->queue.push_back(Job{mountPoints[i], batch, i});
+                batch->pending++;
+            }
+            // a worker per queued job, busy workers may be stuck for good
+            while (mPool->idle < mPool->queue.size() && mPool->workers < kMaxThreads) {
+                mPool->workers++;
+                mPool->idle++;
+                std::thread(&StatvfsProber::workerFunc, mPool).detach();
+            }
+            mPool->cv.notify_all();
+        }
+
+        std::unique_lock lk(batch->mtx);
+        if (!batch->cv.wait_for(lk, deadline, [&batch] { return batch->pending == 0; })) {
+            logMessage(SR_LL_WRN, batch->pending,
+                       " statvfs calls did not finish before the deadline");
+        }
+        return batch->results;
+    }
+
+private:
+    struct Batch {
+        std::mutex mtx;
+        std::condition_variable cv;
+        std::vector<Result> results;
+        size_t pending = 0;
+    };
+
+    struct Job {
+        std::string mountPoint;
+        std::shared_ptr<Batch> batch;
+        size_t index;
+    };
+
+    /// @brief State shared with the detached workers, it outlives the prober if a worker is
+    /// still stuck in the kernel on shutdown.
+    struct Pool {
+        std::mutex mtx;
+        std::condition_variable cv;
+        std::deque<Job> queue;
+        std::unordered_set<std::string> inFlight;
+        StatFunction stat = nullptr;
+        size_t workers = 0;  // busy, idle and stuck ones
+        size_t idle = 0;
+        bool stop = false;
+    };
+
+    static void workerFunc(std::shared_ptr<Pool> pool) {
+        std::unique_lock lk(pool->mtx);
+        while (true) {
+            pool->cv.wait(lk, [&pool] { return pool->stop || !pool->queue.empty(); });
+            if (pool->stop) {
+                break;
+            }
+            Job job = std::move(pool->queue.front());
+            pool->queue.pop_front();
+            pool->idle--;
+            StatFunction const stat(pool->stat);
+            lk.unlock();
+
+            Result result;
+            result.status =
+                stat(job.mountPoint.c_str(), &result.buf) == 0 ? Status::Ok : Status::Failed;
+            lk.lock();
+            // before the result is handed over, a probe right after it must not find the mount
+            // still pending
+            pool->inFlight.erase(job.mountPoint);
+            {
+                std::lock_guard batchLk(job.batch->mtx);
+                job.batch->results[job.index] = result;
+                job.batch->pending--;
+                job.batch->cv.notify_all();
+            }
+            if (pool->queue.empty() && pool->idle >= kMaxWorkers) {
+                // enough idle workers left for the next probe
+                pool->workers--;
+                return;
+            }
+            pool->idle++;
+        }
+        pool->workers--;
+        pool->idle--;
+    }
+
+    std::shared_ptr<Pool> mPool;
+};
+
+}  // namespace metrics
+
+#endif  // STATVFS_PROBER_H
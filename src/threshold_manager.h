@@ -13,74 +13,181 @@
 
 #include <filesystem_stats.h>
 #include <memory_stats.h>
+#include <notification_sender.h>
+#include <scheduler.h>
 #include <utils/globals.h>
 
 #include <chrono>
-#include <condition_variable>
 #include <map>
 #include <math.h>
 #include <mutex>
+#include <set>
 #include <sysrepo-cpp/Connection.hpp>
-#include <thread>
 
 namespace metrics {
 using libyang::Context;
 using libyang::DataNode;
 using sysrepo::Connection;
 
+/// @brief Edge triggered threshold. rising is set once the usage crossed the value upwards,
+/// falling once it dropped below the value minus the hysteresis band again. A crossing has to
+/// persist for holdTime before it counts.
 struct Threshold {
-    Threshold(long double val = 0.0) : value(val), rising(false), falling(false){};
-    long double value;
+    using Clock = std::chrono::steady_clock;
+
+    Threshold(double val = 0.0)
+        : value(val), hysteresis(0.0), holdTime(0), rising(false), falling(false){};
+
+    /// @brief Feed a new usage sample.
+    /// @return the direction of a completed crossing, true for rising, nullopt if none
+    std::optional<bool> evaluate(double usage, Clock::time_point now = Clock::now()) {
+        bool const crossing = rising ? usage < value - hysteresis : usage >= value;
+        if (!crossing) {
+            pendingSince.reset();
+            return std::nullopt;
+        }
+        if (!pendingSince) {
+            pendingSince = now;
+        }
+        if (now - pendingSince.value() < std::chrono::seconds(holdTime)) {
+            return std::nullopt;
+        }
+        pendingSince.reset();
+        rising = !rising;
+        falling = !rising;
+        return rising;
+    }
+
+    double value;
+    double hysteresis;
+    uint32_t holdTime;  // seconds
     bool rising;
     bool falling;
+    std::optional<Clock::time_point> pendingSince;
 };
 
 struct UsageMonitoring {
     using thresholdMap_t = std::unordered_map<std::string, Threshold>;
     using fsThresholdTuple_t = std::tuple<uint32_t, thresholdMap_t>;
 
-    void notify() {
-        mCV.notify_all();
-    }
-
     void injectConnection(Connection conn, std::string const& moduleName) {
-        mConn = std::make_shared<Connection>(conn);
         mModuleName = moduleName;
+        mSender.start(std::make_shared<Connection>(conn), moduleName);
+    }
+
+    /// @brief Send the queued notifications and release the connection, the checks have to be
+    /// stopped first.
+    void stopSender() {
+        mSender.stop();
+    }
+
+    static double decimalValue(libyang::DataNode const& node) {
+        auto const decimal = std::get<libyang::Decimal64>(node.asTerm().value());
+        return decimal.number / std::pow(10, decimal.digits);
     }
 
+    /// @brief Read the poll interval and thresholds of a usage-threshold-group container.
+    static fsThresholdTuple_t readThresholdGroup(libyang::DataNode const& group) {
+        uint32_t poll(60);
+        thresholdMap_t thresholdMap;
+        std::optional<std::pair<std::string, Threshold>> threshold;
+        for (libyang::DataNode const& node : group.childrenDfs()) {
+            libyang::SchemaNode schema = node.schema();
+            std::string const name(schema.name());
+            switch (schema.nodeType()) {
+            case libyang::NodeType::List: {
+                if (name == "threshold") {
+                    if (threshold) {
+                        thresholdMap[threshold->first] = threshold->second;
+                    }
+                    threshold.emplace();
+                }
+                break;
+            }
+            case libyang::NodeType::Leaf: {
+                if (name == "poll-interval") {
+                    poll = std::get<uint32_t>(node.asTerm().value());
+                } else if (!threshold) {
+                    break;
+                } else if (name == "name") {
+                    threshold->first = node.asTerm().valueStr();
+                } else if (name == "value") {
+                    threshold->second.value = decimalValue(node);
+                } else if (name == "hysteresis") {
+                    threshold->second.hysteresis = decimalValue(node);
+                } else if (name == "hold-time") {
+                    threshold->second.holdTime = std::get<uint32_t>(node.asTerm().value());
+                }
+                break;
+            }
+            default:
+                break;
+            }
+        }
+        if (threshold) {
+            thresholdMap[threshold->first] = threshold->second;
+        }
+        return std::make_tuple(poll, thresholdMap);
+    }
+
+    /// @brief Read the usage-threshold-group container at groupPath from the running datastore.
+    static std::optional<fsThresholdTuple_t> readThresholdGroup(sysrepo::Session& session,
+                                                                std::string const& groupPath) {
+        auto const& data(session.getData(groupPath));
+        if (!data) {
+            return std::nullopt;
+        }
+        auto const& group(data.value().findPath(groupPath));
+        if (!group) {
+            return std::nullopt;
+        }
+        return readThresholdGroup(group.value());
+    }
+
+    /// @brief Keep the crossing state of thresholds that are still configured.
+    static void mergeThresholdState(thresholdMap_t& updated, thresholdMap_t const& current) {
+        for (auto& [name, thr] : updated) {
+            auto const itr = current.find(name);
+            if (itr != current.end()) {
+                thr.rising = itr->second.rising;
+                thr.falling = itr->second.falling;
+                thr.pendingSince = itr->second.pendingSince;
+            }
+        }
+    }
+
+    /// @brief Update the threshold state with a new usage value and queue a notification if the
+    /// threshold was crossed.
     void checkAndTriggerNotification(std::string const& sensName,
-                                     Threshold const& thr,
-                                     long double value,
+                                     Threshold& thr,
+                                     double value,
                                      std::string const& type,
                                      std::string mountPoint = std::string()) {
-        std::string notifPath("/" + mModuleName + ":" + type + "-threshold-crossed");
-
-        /* start session */
-        if (!mConn) {
+        std::optional<bool> const rising = thr.evaluate(value);
+        if (!rising) {
             return;
         }
-        auto sess = mConn->sessionStart();
-
-        auto input = sess.getContext().newPath((notifPath + "/name"), sensName);
-        if (type == "filesystem") {
-            input.newPath((notifPath + "/mount-point"), mountPoint);
-        }
-        if (value >= thr.value) {
-            input.newPath((notifPath + "/rising"));
-        } else {
-            input.newPath((notifPath + "/falling"));
+        logMessage(SR_LL_DBG, "Trigger notification for: ", sensName, ": ", value);
+        if (!mSender.enqueue({type, sensName, mountPoint, rising.value(), value})) {
+            logMessage(SR_LL_WRN, "Notification queue full, dropped notification for: ",
+                       sensName);
         }
-        std::stringstream stream;
-        stream << std::fixed << std::setprecision(2) << value;
-        input.newPath((notifPath + "/usage"), stream.str());
+    }
 
-        sess.sendNotification(input, sysrepo::Wait::No);
+    /// @brief Set the notification queue diagnostics under the given container path.
+    void setNotificationQueueXpaths(sysrepo::Session session,
+                                    std::optional<libyang::DataNode>& parent,
+                                    std::string const& queuePath) {
+        NotificationSender::Counters const counters(mSender.counters());
+        setXpath(session, parent, queuePath + "/depth", std::to_string(counters.depth));
+        setXpath(session, parent, queuePath + "/sent", std::to_string(counters.sent));
+        setXpath(session, parent, queuePath + "/dropped", std::to_string(counters.dropped));
+        setXpath(session, parent, queuePath + "/failed", std::to_string(counters.failed));
     }
 
-    std::shared_ptr<Connection> mConn;
     std::mutex mNotificationMtx;
-    std::condition_variable mCV;
     std::string mModuleName;
+    NotificationSender mSender;
 };
 
 struct MemoryMonitoring : public UsageMonitoring {
@@ -94,102 +201,87 @@ struct MemoryMonitoring : public UsageMonitoring {
     void operator=(MemoryMonitoring const&) = delete;
 
     ~MemoryMonitoring() {
-        notifyAndJoin();
+        unschedule();
     }
 
-    void notifyAndJoin() {
-        mCV.notify_all();
-        if (mThread.joinable()) {
-            mThread.join();
-        }
+    void unschedule() {
+        Scheduler::getInstance().cancel(kSchedulerKey);
     }
 
-    void startThread() {
-        if (mMemoryThesholds.empty()) {
-            return;
-        }
-        if (mThread.joinable()) {
-            mThread.join();
+    /// @brief Stop the checks and the notifications on plugin cleanup. The thresholds are
+    /// dropped, the next configuration applied schedules the check again.
+    void stop() {
+        unschedule();
+        {
+            std::lock_guard lk(mNotificationMtx);
+            mMemoryThesholds.clear();
         }
-        logMessage(SR_LL_DBG, "Thread for memory thresholds started.");
-        mThread = std::thread(&MemoryMonitoring::runFunc, this);
+        stopSender();
     }
 
-    void runFunc() {
-        std::unique_lock<std::mutex> lk(mNotificationMtx);
-        while (mCV.wait_for(lk, std::chrono::seconds(mPollInterval)) == std::cv_status::timeout) {
-            long double value = MemoryStats::getInstance().getUsage();
-            for (auto const& [name, thrValue] : mMemoryThesholds) {
-                logMessage(SR_LL_DBG, std::string("Trigger notification for: ") + name + ": " +
-                                          std::to_string(value));
-                checkAndTriggerNotification(name, thrValue, value, "memory");
-            }
+    void check() {
+        std::lock_guard lk(mNotificationMtx);
+        double value = MemoryStats::getInstance().getUsage();
+        for (auto& [name, thrValue] : mMemoryThesholds) {
+            checkAndTriggerNotification(name, thrValue, value, "memory");
         }
-        logMessage(SR_LL_DBG, "Thread for memory thresholds ended.");
     }
 
-    void populateConfigData(sysrepo::Session& session, std::string_view moduleName) {
-        std::string const data_xpath(std::string("/") + std::string(moduleName) +
-                                     ":system-metrics/memory");
-        auto const& data(session.getData(data_xpath));
-        if (!data) {
-            logMessage(SR_LL_ERR, "No data found for population.");
+    /// @brief Apply the memory usage-monitoring changes of a config change event. Thresholds
+    /// keep their crossing state and the check keeps its timing if the poll-interval is unchanged.
+    void applyChanges(sysrepo::Session& session, std::string_view moduleName) {
+        std::string const groupPath(std::string("/") + std::string(moduleName) +
+                                    ":system-metrics/memory/usage-monitoring");
+        auto const& changes(session.getChanges(groupPath + "//."));
+        if (changes.begin() == changes.end()) {
             return;
         }
-        std::shared_ptr<std::pair<std::string, Threshold>> threshold;
-        mMemoryThesholds.clear();
-
-        for (libyang::DataNode const& node : data.value().childrenDfs()) {
-            libyang::SchemaNode schema = node.schema();
-            switch (schema.nodeType()) {
-            case libyang::NodeType::List: {
-                if (std::string(schema.name()) == "threshold" && threshold) {
-                    mMemoryThesholds[threshold->first] = threshold->second;
-                }
-                break;
-            }
-            case libyang::NodeType::Leaf: {
-                if (schema.asLeaf().isKey()) {
-                    threshold = std::make_shared<std::pair<std::string, Threshold>>();
-                    threshold->first = node.asTerm().valueStr();
-                } else if (std::string(schema.name()) == "value") {
-                    threshold->second.value =
-                        std::get<libyang::Decimal64>(node.asTerm().value()).number /
-                        std::pow(10, std::get<libyang::Decimal64>(node.asTerm().value()).digits);
-                }
-
-                if (std::string(schema.name()) == "poll-interval") {
-                    mPollInterval = std::get<uint32_t>(node.asTerm().value());
-                }
-                break;
-            }
-            default:
-                break;
-            }
+        std::optional<fsThresholdTuple_t> config(readThresholdGroup(session, groupPath));
+
+        std::unique_lock lk(mNotificationMtx);
+        if (!config || std::get<1>(config.value()).empty()) {
+            logMessage(SR_LL_DBG, "Memory thresholds check removed.");
+            mMemoryThesholds.clear();
+            // a running check takes the lock, it is waited for without it
+            lk.unlock();
+            unschedule();
+            return;
         }
-        if (threshold) {
-            mMemoryThesholds[threshold->first] = threshold->second;
+        auto& [poll, thresholdMap] = config.value();
+        mergeThresholdState(thresholdMap, mMemoryThesholds);
+        bool const reschedule(mMemoryThesholds.empty() || poll != mPollInterval);
+        mPollInterval = poll;
+        mMemoryThesholds = std::move(thresholdMap);
+        if (reschedule) {
+            logMessage(SR_LL_DBG, "Memory thresholds check scheduled.");
+            Scheduler::getInstance().schedule(kSchedulerKey, std::chrono::seconds(mPollInterval),
+                                              [this] { check(); });
         }
     }
 
     void setXpaths(sysrepo::Session session,
                    std::optional<libyang::DataNode>& parent,
-                   std::string_view moduleName) const {
+                   std::string_view moduleName) {
+        std::lock_guard lk(mNotificationMtx);
         std::string configPath("/" + std::string(moduleName) +
                                ":system-metrics/memory/usage-monitoring/");
         setXpath(session, parent, configPath + "poll-interval", std::to_string(mPollInterval));
         for (auto const& [name, thr] : mMemoryThesholds) {
-            std::stringstream stream;
-            stream << std::fixed << std::setprecision(2) << thr.value;
-            setXpath(session, parent, configPath + "threshold[name='" + name + "']/value",
-                     stream.str());
+            std::string const thresholdPath(configPath + "threshold" + keyPredicate("name", name));
+            setXpath(session, parent, thresholdPath + "/value", formatPercent(thr.value));
+            setXpath(session, parent, thresholdPath + "/hysteresis", formatPercent(thr.hysteresis));
+            setXpath(session, parent, thresholdPath + "/hold-time", std::to_string(thr.holdTime));
         }
     }
 
 private:
-    MemoryMonitoring() : mPollInterval(60){};
+    static constexpr char const* kSchedulerKey = "memory";
+
+    // the scheduler is constructed first so it outlives the monitoring on destruction
+    MemoryMonitoring() : mPollInterval(60) {
+        Scheduler::getInstance();
+    };
     thresholdMap_t mMemoryThesholds;
-    std::thread mThread;
     uint32_t mPollInterval;
 };
 
@@ -203,116 +295,62 @@ struct FilesystemMonitoring : public UsageMonitoring {
     void operator=(FilesystemMonitoring const&) = delete;
 
     ~FilesystemMonitoring() {
-        notifyAndJoin();
+        unschedule();
     }
 
-    void notifyAndJoin() {
-        mCV.notify_all();
-        stopThreads();
+    void unschedule() {
+        Scheduler::getInstance().cancelPrefix(kSchedulerKeyPrefix);
     }
 
-    void stopThreads() {
-        int32_t numThreadsStopped(0);
-        for (auto& [_, thread] : mFsThreads) {
-            if (thread.joinable()) {
-                thread.join();
-                numThreadsStopped++;
-            }
+    /// @brief Stop the checks and the notifications on plugin cleanup. The thresholds are
+    /// dropped, the next configuration applied schedules the checks again.
+    void stop() {
+        unschedule();
+        {
+            std::lock_guard lk(mNotificationMtx);
+            mFsThresholds.clear();
         }
-        logMessage(SR_LL_DBG, std::to_string(numThreadsStopped) +
-                                  " filesystem threads stopped, out of: " +
-                                  std::to_string(mFsThreads.size()) + " started.");
-        mFsThreads.clear();
+        stopSender();
     }
 
-    void startThreads() {
-        if (mFsThresholds.empty()) {
+    void check(std::string const& name) {
+        std::unique_lock lk(mNotificationMtx);
+        if (mFsThresholds.find(name) == mFsThresholds.end()) {
             return;
         }
-        for (auto const& [name, _] : mFsThresholds) {
-            logMessage(SR_LL_DBG, "Starting thread for filesystem: " + name + ".");
-            mFsThreads[name] = std::thread(&FilesystemMonitoring::runFunc, this, name);
-        }
-    }
-
-    void runFunc(std::string const& name) {
-        std::unique_lock<std::mutex> lk(mNotificationMtx);
-        std::unordered_map<std::string, fsThresholdTuple_t>::iterator itr;
-        if ((itr = mFsThresholds.find(name)) != mFsThresholds.end()) {
-            while (mCV.wait_for(lk, std::chrono::seconds(std::get<0>(itr->second))) ==
-                   std::cv_status::timeout) {
-                std::optional<long double> usageValue =
-                    FilesystemStats::getInstance().getUsage(name);
-                if (!usageValue) {
-                    logMessage(SR_LL_WRN, std::string("No filesystem found: ") + name);
-                    break;
-                }
-                for (auto const& [thrName, thrValue] : std::get<1>(itr->second)) {
-                    logMessage(SR_LL_DBG, std::string("Trigger notification for: ") + thrName +
-                                              ": " + std::to_string(usageValue.value()));
-                    checkAndTriggerNotification(thrName, thrValue, usageValue.value(), "filesystem",
-                                                name);
-                }
-            }
+        // the probe of a hung mount takes up to the statvfs deadline, the oper data and config
+        // changes do not wait for it
+        lk.unlock();
+        std::optional<double> usageValue = FilesystemStats::getInstance().getUsage(name);
+        if (!usageValue) {
+            logMessage(SR_LL_WRN, "No filesystem found: ", name);
+            return;
         }
-        logMessage(SR_LL_DBG, "Thread for filesystem: " + name + " ended.");
-    }
-
-    void populateConfigData(sysrepo::Session& session, std::string_view moduleName) {
-        std::string const data_xpath(std::string("/") + std::string(moduleName) +
-                                     ":system-metrics/filesystems");
-        auto const& data(session.getData(data_xpath));
-        if (!data) {
-            logMessage(SR_LL_ERR, "No data found for population.");
+        lk.lock();
+        // the thresholds may have been changed or removed meanwhile, the current ones count
+        auto const itr = mFsThresholds.find(name);
+        if (itr == mFsThresholds.end()) {
             return;
         }
+        for (auto& [thrName, thrValue] : std::get<1>(itr->second)) {
+            checkAndTriggerNotification(thrName, thrValue, usageValue.value(), "filesystem", name);
+        }
+    }
 
-        thresholdMap_t thresholdMap;
-        std::shared_ptr<std::pair<std::string, Threshold>> threshold;
-        std::string mountPoint("");
-        uint32_t poll(60);
-        mFsThresholds.clear();
-        for (libyang::DataNode const& node : data.value().childrenDfs()) {
-            libyang::SchemaNode schema = node.schema();
-            switch (schema.nodeType()) {
-            case libyang::NodeType::List: {
-                if (std::string(schema.name()) == "threshold" && threshold) {
-                    thresholdMap[threshold->first] = threshold->second;
-                }
-                break;
-            }
-            case libyang::NodeType::Leaf: {
-                if (schema.asLeaf().isKey() && std::string(schema.name()) == "mount-point") {
-                    if (threshold) {
-                        thresholdMap[threshold->first] = threshold->second;
-                    }
-                    if (!thresholdMap.empty()) {
-                        mFsThresholds[mountPoint] = std::make_tuple(poll, thresholdMap);
-                    }
-                    thresholdMap.clear();
-                    mountPoint = node.asTerm().valueStr();
-                    threshold.reset();
-                } else if (schema.asLeaf().isKey() && std::string(schema.name()) == "name") {
-                    threshold = std::make_shared<std::pair<std::string, Threshold>>();
-                    threshold->first = node.asTerm().valueStr();
-                } else if (std::string(schema.name()) == "value") {
-                    threshold->second.value =
-                        std::get<libyang::Decimal64>(node.asTerm().value()).number /
-                        std::pow(10, std::get<libyang::Decimal64>(node.asTerm().value()).digits);
-                }
-
-                if (std::string(schema.name()) == "poll-interval") {
-                    poll = std::get<uint32_t>(node.asTerm().value());
-                }
-                break;
-            }
-            default:
-                break;
+    /// @brief Apply the filesystem changes of a config change event. Only the mount points
+    /// touched by the change are re-read, the checks of all others keep running untouched.
+    void applyChanges(sysrepo::Session& session, std::string_view moduleName) {
+        std::string const filesystemsPath(std::string("/") + std::string(moduleName) +
+                                          ":system-metrics/filesystems");
+        std::set<std::string> mountPoints;
+        for (auto const& change : session.getChanges(filesystemsPath + "//.")) {
+            auto const mountPoint(mountPointOf(change.node));
+            if (mountPoint) {
+                mountPoints.insert(mountPoint.value());
             }
         }
-        if (threshold) {
-            thresholdMap[threshold->first] = threshold->second;
-            mFsThresholds[mountPoint] = std::make_tuple(poll, thresholdMap);
+        for (auto const& mountPoint : mountPoints) {
+            applyMountPoint(session, filesystemsPath, mountPoint);
         }
     }
 
@@ -321,6 +359,7 @@ struct FilesystemMonitoring : public UsageMonitoring {
             std::cout << "name: " << name << "\t poll:" << std::get<0>(thresholds);
             for (auto const& [thrName, thrValue] : std::get<1>(thresholds)) {
                 std::cout << "\t thr-name: " << thrName << " thr-value" << thrValue.value << " "
+                          << thrValue.hysteresis << " " << thrValue.holdTime << " "
                           << thrValue.rising << " " << thrValue.falling << std::endl;
             }
         }
@@ -328,26 +367,88 @@ struct FilesystemMonitoring : public UsageMonitoring {
 
     void setXpaths(sysrepo::Session session,
                    std::optional<libyang::DataNode>& parent,
-                   std::string_view moduleName) const {
+                   std::string_view moduleName) {
+        std::lock_guard lk(mNotificationMtx);
+        setNotificationQueueXpaths(session, parent,
+                                   "/" + std::string(moduleName) +
+                                       ":system-metrics/filesystems/notification-queue");
         for (auto const& [fsName, thresholdTuple] : mFsThresholds) {
             std::string const configPath("/" + std::string(moduleName) +
-                                         ":system-metrics/filesystems/filesystem[mount-point='" +
-                                         fsName + "']/usage-monitoring/");
+                                         ":system-metrics/filesystems/filesystem" +
+                                         keyPredicate("mount-point", fsName) +
+                                         "/usage-monitoring/");
             setXpath(session, parent, configPath + "poll-interval",
                      std::to_string(std::get<0>(thresholdTuple)));
             for (auto const& [name, thr] : std::get<1>(thresholdTuple)) {
-                std::stringstream stream;
-                stream << std::fixed << std::setprecision(2) << thr.value;
-                setXpath(session, parent, configPath + "threshold[name='" + name + "']/value",
-                         stream.str());
+                std::string const thresholdPath(configPath + "threshold" +
+                                                keyPredicate("name", name));
+                setXpath(session, parent, thresholdPath + "/value", formatPercent(thr.value));
+                setXpath(session, parent, thresholdPath + "/hysteresis",
+                         formatPercent(thr.hysteresis));
+                setXpath(session, parent, thresholdPath + "/hold-time",
+                         std::to_string(thr.holdTime));
             }
         }
     }
 
 private:
-    FilesystemMonitoring() = default;
+    static constexpr char const* kSchedulerKeyPrefix = "filesystem:";
+
+    /// @brief Key of the filesystem list entry a changed node belongs to.
+    static std::optional<std::string> mountPointOf(libyang::DataNode const& node) {
+        for (std::optional<libyang::DataNode> itr(node); itr; itr = itr->parent()) {
+            if (itr->schema().nodeType() == libyang::NodeType::List &&
+                std::string(itr->schema().name()) == "filesystem") {
+                auto const& key(itr->findPath("mount-point"));
+                if (key) {
+                    return key->asTerm().valueStr();
+                }
+            }
+        }
+        return std::nullopt;
+    }
+
+    void applyMountPoint(sysrepo::Session& session,
+                         std::string const& filesystemsPath,
+                         std::string const& mountPoint) {
+        std::optional<fsThresholdTuple_t> config(readThresholdGroup(
+            session,
+            filesystemsPath + "/filesystem" + keyPredicate("mount-point", mountPoint) +
+                "/usage-monitoring"));
+
+        std::unique_lock lk(mNotificationMtx);
+        auto const itr = mFsThresholds.find(mountPoint);
+        if (!config || std::get<1>(config.value()).empty()) {
+            if (itr != mFsThresholds.end()) {
+                logMessage(SR_LL_DBG, "Filesystem thresholds check removed for: ", mountPoint,
+                           ".");
+                mFsThresholds.erase(itr);
+                // a running check takes the lock, it is waited for without it
+                lk.unlock();
+                Scheduler::getInstance().cancel(kSchedulerKeyPrefix + mountPoint);
+            }
+            return;
+        }
+        auto& [poll, thresholdMap] = config.value();
+        bool reschedule(true);
+        if (itr != mFsThresholds.end()) {
+            mergeThresholdState(thresholdMap, std::get<1>(itr->second));
+            reschedule = poll != std::get<0>(itr->second);
+        }
+        mFsThresholds[mountPoint] = std::make_tuple(poll, std::move(thresholdMap));
+        if (reschedule) {
+            logMessage(SR_LL_DBG, "Filesystem thresholds check scheduled for: ", mountPoint, ".");
+            Scheduler::getInstance().schedule(kSchedulerKeyPrefix + mountPoint,
+                                              std::chrono::seconds(poll),
+                                              [this, mountPoint] { check(mountPoint); });
+        }
+    }
+
+    // the scheduler is constructed first so it outlives the monitoring on destruction
+    FilesystemMonitoring() {
+        Scheduler::getInstance();
+    };
     std::unordered_map<std::string, fsThresholdTuple_t> mFsThresholds;
-    std::unordered_map<std::string, std::thread> mFsThreads;
 };
 
 }  // namespace metrics
@@ -0,0 +1,244 @@
+// telekom / sysrepo-plugin-os-metrics
+//
+// This program is made available under the terms of the
+// BSD 3-Clause license which is available at
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// SPDX-FileCopyrightText: 2022 Deutsche Telekom AG
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef URING_PROC_READER_H
+#define URING_PROC_READER_H
+
+#include <utils/globals.h>
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <fcntl.h>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifdef HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+namespace metrics {
+
+/// @brief Reads /proc/<pid>/{stat,status,io} of a batch of processes with io_uring. Every file
+/// is an openat into a direct descriptor slot, a read and a close, linked and submitted for the
+/// whole batch with one system call. Not available without liburing, or when the kernel lacks
+/// direct descriptors (before 5.19), callers then fall back to ProcReader.
+struct UringProcReader {
+    enum File { Stat = 0, Status, Io, FileCount };
+
+    static constexpr unsigned kBatchSize = 64;  // processes per submission
+    static constexpr size_t kBufferSize = 4096;
+
+    UringProcReader() : mAvailable(false) {
+#ifdef HAVE_LIBURING
+        if (io_uring_queue_init(kBatchSize * FileCount * 3, &mRing, 0) != 0) {
+            return;
+        }
+        struct io_uring_probe* probe = io_uring_get_probe_ring(&mRing);
+        bool const supported = probe && io_uring_opcode_supported(probe, IORING_OP_OPENAT) &&
+                               io_uring_opcode_supported(probe, IORING_OP_READ) &&
+                               io_uring_opcode_supported(probe, IORING_OP_CLOSE);
+        if (probe) {
+            io_uring_free_probe(probe);
+        }
+        if (!supported || io_uring_register_files_sparse(&mRing, kBatchSize * FileCount) != 0) {
+            io_uring_queue_exit(&mRing);
+            return;
+        }
+        mBuffers.resize(kBatchSize * FileCount * kBufferSize);
+        mPaths.resize(kBatchSize * FileCount);
+        mAvailable = true;
+#endif
+    }
+
+    ~UringProcReader() {
+#ifdef HAVE_LIBURING
+        shutDown();
+#endif
+    }
+
+    UringProcReader(UringProcReader const&) = delete;
+    void operator=(UringProcReader const&) = delete;
+
+    bool available() const {
+        return mAvailable;
+    }
+
+    /// @brief Read the files of up to kBatchSize processes.
+    /// @param onFile called as completions arrive with (index into pids, file, content), content
+    /// is empty if the file could not be read, or nullopt if it did not fit the buffer
+    /// @return false if the submission failed, the reader is unavailable and the content passed
+    /// on so far has to be dropped then
+    template <typename F>
+    bool readBatch(int32_t const* pids, size_t count, F&& onFile) {
+#ifdef HAVE_LIBURING
+        if (!mAvailable || count > kBatchSize) {
+            return false;
+        }
+        static char const* const kNames[FileCount] = {"stat", "status", "io"};
+        unsigned prepared(0);
+        for (size_t i = 0; i < count; i++) {
+            for (unsigned file = 0; file < FileCount; file++) {
+                unsigned const slot = i * FileCount + file;
+                snprintf(mPaths[slot].data(), mPaths[slot].size(), "/proc/%d/%s", pids[i],
+                         kNames[file]);
+
+                // a failed open cancels the read and close, the close runs even if the read
+                // fails. Direct descriptors are never installed in the fd table, the kernel
+                // rejects O_CLOEXEC for them.
+                struct io_uring_sqe* sqe = io_uring_get_sqe(&mRing);
+                io_uring_prep_openat_direct(sqe, AT_FDCWD, mPaths[slot].data(), O_RDONLY, 0,
+                                            slot);
+                io_uring_sqe_set_flags(sqe, IOSQE_IO_LINK);
+                io_uring_sqe_set_data64(sqe, userData(slot, Op::Open));
+
+                sqe = io_uring_get_sqe(&mRing);
+                io_uring_prep_read(sqe, slot, buffer(slot), kBufferSize, 0);
+                io_uring_sqe_set_flags(sqe, IOSQE_FIXED_FILE | IOSQE_IO_HARDLINK);
+                io_uring_sqe_set_data64(sqe, userData(slot, Op::Read));
+
+                sqe = io_uring_get_sqe(&mRing);
+                io_uring_prep_close_direct(sqe, slot);
+                io_uring_sqe_set_data64(sqe, userData(slot, Op::Close));
+                prepared += 3;
+            }
+        }
+        // the kernel may consume fewer entries than prepared, only those complete
+        unsigned submitted(0);
+        int rc(0);
+        while (submitted < prepared && (rc = io_uring_submit(&mRing)) > 0) {
+            submitted += rc;
+        }
+        bool const complete(submitted == prepared);
+        if (!complete) {
+            logMessage(SR_LL_WRN, "io_uring submitted ", submitted, " of ", prepared,
+                       " entries: ", rc);
+        }
+
+        for (unsigned completed = 0; completed < submitted; completed++) {
+            struct io_uring_cqe* cqe;
+            rc = io_uring_wait_cqe(&mRing, &cqe);
+            if (rc < 0) {
+                logMessage(SR_LL_WRN, "io_uring wait failed: ", rc);
+                shutDown();
+                return false;
+            }
+            uint64_t const data = io_uring_cqe_get_data64(cqe);
+            int const res = cqe->res;
+            io_uring_cqe_seen(&mRing, cqe);
+
+            unsigned const slot = data >> 2;
+            if (!complete || static_cast<Op>(data & 3) != Op::Read) {
+                continue;
+            }
+            size_t const index = slot / FileCount;
+            File const file = static_cast<File>(slot % FileCount);
+            std::optional<std::string_view> content;
+            if (res < 0) {
+                content = std::string_view();
+            } else if (static_cast<size_t>(res) < kBufferSize) {
+                content = std::string_view(buffer(slot), res);
+            }
+            onFile(index, file, content);
+        }
+        if (!complete) {
+            // the entries left in the submission queue would go out with the next batch
+            shutDown();
+            return false;
+        }
+        return true;
+#else
+        (void)pids;
+        (void)count;
+        (void)onFile;
+        return false;
+#endif
+    }
+
+private:
+#ifdef HAVE_LIBURING
+    enum class Op : uint64_t { Open = 0, Read, Close };
+
+    /// @brief Tear down a ring left in an unknown state, requests still in flight are
+    /// cancelled by the kernel. The reader is unavailable from then on.
+    void shutDown() {
+        if (mAvailable) {
+            io_uring_queue_exit(&mRing);
+            mAvailable = false;
+        }
+    }
+
+    static uint64_t userData(unsigned slot, Op op) {
+        return (static_cast<uint64_t>(slot) << 2) | static_cast<uint64_t>(op);
+    }
+
+    char* buffer(unsigned slot) {
+        return mBuffers.data() + slot * kBufferSize;
+    }
+
+    struct io_uring mRing;
+    std::vector<char> mBuffers;
+    std::vector<std::array<char, 32>> mPaths;
+#endif
+    bool mAvailable;
+};
+
+/// @brief Readers of finished collections kept for the next ones, so a ring, its descriptor
+/// table and its buffers are set up once per worker thread instead of once per request.
+struct UringProcReaderPool {
+    UringProcReaderPool() : mUnsupported(false) {
+    }
+
+    /// @return a reader, nullptr if rings cannot be set up on this kernel
+    std::unique_ptr<UringProcReader> acquire() {
+        {
+            std::lock_guard lk(mMtx);
+            if (!mReaders.empty()) {
+                auto reader(std::move(mReaders.back()));
+                mReaders.pop_back();
+                return reader;
+            }
+            if (mUnsupported) {
+                return nullptr;
+            }
+        }
+        auto reader(std::make_unique<UringProcReader>());
+        if (!reader->available()) {
+            std::lock_guard lk(mMtx);
+            mUnsupported = true;
+            return nullptr;
+        }
+        return reader;
+    }
+
+    /// @brief Keep a reader for later, unless it failed or keep readers are pooled already.
+    void release(std::unique_ptr<UringProcReader> reader, size_t keep) {
+        if (!reader || !reader->available()) {
+            return;
+        }
+        std::lock_guard lk(mMtx);
+        if (mReaders.size() < keep) {
+            mReaders.push_back(std::move(reader));
+        }
+    }
+
+private:
+    std::mutex mMtx;
+    std::vector<std::unique_ptr<UringProcReader>> mReaders;
+    bool mUnsupported;
+};
+
+}  // namespace metrics
+
+#endif  // URING_PROC_READER_H
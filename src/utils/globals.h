@@ -11,28 +11,88 @@
 #ifndef GLOBALS_H
 #define GLOBALS_H
 
-#define FILESYSTEM_STATS_LOCATION "/tmp/df_output1.tmp"
-#define FILESYSTEM_STATS_LOCATION2 "/tmp/df_output2.tmp"
-
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <initializer_list>
+#include <libyang/libyang.h>
+#include <memory_resource>
+#include <optional>
+#include <string_view>
 #include <sysrepo-cpp/Session.hpp>
 #include <sysrepo.h>
+#include <type_traits>
+
+/// @brief Most detailed level of the messages this plugin passes on to sysrepo, set from the
+/// logging/level leaf, nullopt while the leaf is not set. The log configuration of the daemon is
+/// shared with sysrepo and the other plugins, it is never changed from here.
+[[maybe_unused]] static std::atomic<std::optional<sr_log_level_t>>& pluginLogLevel() {
+    static std::atomic<std::optional<sr_log_level_t>> level;
+    return level;
+}
+
+/// @brief Whether a message of a level is passed on to sysrepo. With the logging/level leaf set,
+/// that is every message up to its level. Sysrepo then filters them by its stderr and syslog
+/// levels, a log callback of the host receives all of them. Without the leaf, messages up to
+/// info are passed on, debug messages only if stderr or syslog show them, so they cost a level
+/// check in the hot paths. The levels are read on every call, changes at runtime take effect
+/// with the next message.
+[[maybe_unused]] static bool logEnabled(sr_log_level_t log) {
+    auto const level(pluginLogLevel().load(std::memory_order_relaxed));
+    if (level) {
+        return log <= level.value();
+    }
+    return log <= SR_LL_INF || log <= sr_log_get_stderr() || log <= sr_log_get_syslog();
+}
 
-static void logMessage(sr_log_level_t log, std::string const& msg) {
-    static std::string const _("OS-Metrics");
+static void logMessage(sr_log_level_t log, std::string_view msg) {
+    static char const* const _("OS-Metrics");
+    if (!logEnabled(log)) {
+        return;
+    }
+    // the message is an argument, not the format, it may contain a '%'
+    int const length(static_cast<int>(msg.size()));
     switch (log) {
     case SR_LL_ERR:
-        SRPLG_LOG_ERR(_.c_str(), msg.c_str());
+        SRPLG_LOG_ERR(_, "%.*s", length, msg.data());
         break;
     case SR_LL_WRN:
-        SRPLG_LOG_WRN(_.c_str(), msg.c_str());
+        SRPLG_LOG_WRN(_, "%.*s", length, msg.data());
         break;
     case SR_LL_INF:
-        SRPLG_LOG_INF(_.c_str(), msg.c_str());
+        SRPLG_LOG_INF(_, "%.*s", length, msg.data());
         break;
     case SR_LL_DBG:
     default:
-        SRPLG_LOG_DBG(_.c_str(), msg.c_str());
+        SRPLG_LOG_DBG(_, "%.*s", length, msg.data());
+    }
+}
+
+/// @brief Set the plugin level, nullopt restores the default of logEnabled().
+[[maybe_unused]] static void setLogLevel(std::optional<sr_log_level_t> log) {
+    pluginLogLevel().store(log, std::memory_order_relaxed);
+}
+
+template <typename T>
+static void appendLogArgument(std::string& msg, T const& argument) {
+    if constexpr (std::is_arithmetic_v<T>) {
+        msg += std::to_string(argument);
+    } else {
+        msg += argument;
+    }
+}
+
+/// @brief Log the concatenation of the arguments, strings and numbers. Nothing is formatted if
+/// the level is not enabled, so debug messages in hot paths cost one level check.
+template <typename... Args>
+requires(sizeof...(Args) > 1)
+[[maybe_unused]] static void logMessage(sr_log_level_t log, Args const&... arguments) {
+    if (!logEnabled(log)) {
+        return;
     }
+    std::string msg;
+    (appendLogArgument(msg, arguments), ...);
+    logMessage(log, std::string_view(msg));
 }
 
 static bool setXpath(sysrepo::Session& session,
@@ -46,13 +106,165 @@ static bool setXpath(sysrepo::Session& session,
             parent = session.getContext().newPath(node_xpath, value);
         }
     } catch (std::runtime_error const& e) {
-        logMessage(SR_LL_WRN,
-                   "At path " + node_xpath + ", value " + value + " " + ", error: " + e.what());
+        logMessage(SR_LL_WRN, "At path ", node_xpath, ", value ", value, ", error: ", e.what());
+        return false;
+    }
+    return true;
+}
+
+/// @brief Key predicate of a list entry, like [name='value']. Values containing a ' are
+/// quoted with " instead, e.g. mount points.
+[[maybe_unused]] static std::string keyPredicate(std::string_view key, std::string_view value) {
+    char const quote(value.find('\'') == std::string_view::npos ? '\'' : '"');
+    std::string predicate;
+    predicate.reserve(key.size() + value.size() + 5);
+    predicate.append("[").append(key).append("=");
+    predicate.append(1, quote).append(value).append(1, quote).append("]");
+    return predicate;
+}
+
+/// @brief Format a value with two fraction digits, as the decimal64 leaves expect. None of them
+/// is negative, a rounding error below 0 would otherwise be written as "-0.00".
+/// @return the null terminated text in buffer
+[[maybe_unused]] static char const* formatDecimal(double value, char (&buffer)[32]) {
+    if (!(value > 0.0)) {
+        value = 0.0;
+    }
+    auto const result =
+        std::to_chars(buffer, buffer + sizeof(buffer) - 1, value, std::chars_format::fixed, 2);
+    if (result.ec != std::errc()) {
+        return "0.00";
+    }
+    *result.ptr = '\0';
+    return buffer;
+}
+
+/// @brief Written with to_chars into a stack buffer, the result fits the small string buffer.
+[[maybe_unused]] static std::string formatDecimal(double value) {
+    char buffer[32];
+    return formatDecimal(value, buffer);
+}
+
+/// @brief Like formatDecimal(), clamped to the 0 .. 100 range of the percent leaves.
+[[maybe_unused]] static char const* formatPercent(double value, char (&buffer)[32]) {
+    return formatDecimal(std::min(value, 100.0), buffer);
+}
+
+[[maybe_unused]] static std::string formatPercent(double value) {
+    char buffer[32];
+    return formatPercent(value, buffer);
+}
+
+/// @brief Create the node at an absolute path, typically a list entry, so its children can be
+/// added with setXpath() relative to it instead of resolving their full path from the root.
+/// The tree is started if parent is empty.
+/// @return the node, or nullopt if it could not be created
+[[maybe_unused]] static std::optional<libyang::DataNode>
+createXpath(sysrepo::Session& session,
+            std::optional<libyang::DataNode>& parent,
+            std::string const& node_xpath) {
+    try {
+        if (parent) {
+            // with update an existing node, e.g. a repeated list entry, is not an error but
+            // creates nothing, it is looked up then
+            auto const created =
+                parent.value()
+                    .newPath2(node_xpath, std::nullopt, libyang::CreationOptions::Update)
+                    .createdNode;
+            return created ? created : parent.value().findPath(node_xpath);
+        }
+        auto const nodes = session.getContext().newPath2(node_xpath);
+        parent = nodes.createdParent;
+        return nodes.createdNode;
+    } catch (std::runtime_error const& e) {
+        logMessage(SR_LL_WRN, "At path ", node_xpath, ", error: ", e.what());
+    }
+    return std::nullopt;
+}
+
+/// @brief Scratch memory for the strings of one oper-get callback. They are carved from an
+/// inline buffer, large trees spill over to the heap in a few big blocks, and everything is
+/// released at once when the arena goes out of scope at the end of the callback.
+struct XpathArena {
+    static constexpr size_t kInlineSize = 16 * 1024;
+
+    XpathArena() : mResource(mBuffer, sizeof(mBuffer)){};
+
+    XpathArena(XpathArena const&) = delete;
+    void operator=(XpathArena const&) = delete;
+
+    std::pmr::string concat(std::initializer_list<std::string_view> parts) {
+        size_t size(0);
+        for (auto const& part : parts) {
+            size += part.size();
+        }
+        std::pmr::string result(&mResource);
+        result.reserve(size);
+        for (auto const& part : parts) {
+            result.append(part);
+        }
+        return result;
+    }
+
+private:
+    alignas(std::max_align_t) char mBuffer[kInlineSize];
+    std::pmr::monotonic_buffer_resource mResource;
+};
+
+/// @brief Like setXpath(), through the C API so neither path nor value need a std::string.
+[[maybe_unused]] static bool
+setXpath(lyd_node* parent, char const* node_xpath, char const* value) {
+    if (lyd_new_path(parent, nullptr, node_xpath, value, 0, nullptr) != LY_SUCCESS) {
+        logMessage(SR_LL_WRN, "At path ", node_xpath, ", value ", value, ", error: ",
+                   ly_errmsg(LYD_CTX(parent)));
         return false;
     }
     return true;
 }
 
+template <typename T>
+requires std::is_integral_v<T>
+[[maybe_unused]] static bool setXpath(lyd_node* parent, char const* node_xpath, T value) {
+    char buffer[24];
+    *std::to_chars(buffer, buffer + sizeof(buffer) - 1, value).ptr = '\0';
+    return setXpath(parent, node_xpath, static_cast<char const*>(buffer));
+}
+
+[[maybe_unused]] static bool
+setDecimalXpath(lyd_node* parent, char const* node_xpath, double value) {
+    char buffer[32];
+    return setXpath(parent, node_xpath, formatDecimal(value, buffer));
+}
+
+[[maybe_unused]] static bool
+setPercentXpath(lyd_node* parent, char const* node_xpath, double value) {
+    char buffer[32];
+    return setXpath(parent, node_xpath, formatPercent(value, buffer));
+}
+
+/// @brief Like createXpath(), through the C API, children are then added with the
+/// lyd_node* setXpath() overloads.
+/// @return the node, or nullptr if it could not be created
+[[maybe_unused]] static lyd_node* createXpath(sysrepo::Session& session,
+                                              std::optional<libyang::DataNode>& parent,
+                                              char const* node_xpath) {
+    if (!parent) {
+        auto const node = createXpath(session, parent, std::string(node_xpath));
+        return node ? libyang::getRawNode(node.value()) : nullptr;
+    }
+    lyd_node* const tree(libyang::getRawNode(parent.value()));
+    lyd_node* created(nullptr);
+    // with update an existing node, e.g. a repeated list entry, is not an error but creates
+    // nothing, it is looked up then
+    if (lyd_new_path2(tree, nullptr, node_xpath, nullptr, 0, LYD_ANYDATA_STRING,
+                      LYD_NEW_PATH_UPDATE, nullptr, &created) != LY_SUCCESS ||
+        (!created && lyd_find_path(tree, node_xpath, 0, &created) != LY_SUCCESS)) {
+        logMessage(SR_LL_WRN, "At path ", node_xpath, ", error: ", ly_errmsg(LYD_CTX(tree)));
+        return nullptr;
+    }
+    return created;
+}
+
 [[maybe_unused]] static std::optional<libyang::Module> findModule(sysrepo::Session session,
                                                                   std::string_view moduleName) {
     auto const& modules = session.getContext().modules();
@@ -69,6 +281,10 @@ static bool setXpath(sysrepo::Session& session,
 static void printCurrentConfig(sysrepo::Session& session,
                                std::string_view module_name,
                                std::string const& node) {
+    // fetching and printing the whole configuration is only worth it if it is shown
+    if (!logEnabled(SR_LL_DBG)) {
+        return;
+    }
     try {
         std::string xpath(std::string("/") + std::string(module_name) + std::string(":") + node);
         auto values = session.getData(xpath);
@@ -0,0 +1,57 @@
+// telekom / sysrepo-plugin-os-metrics
+//
+// This program is made available under the terms of the
+// BSD 3-Clause license which is available at
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// SPDX-FileCopyrightText: 2022 Deutsche Telekom AG
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef XPATH_CACHE_H
+#define XPATH_CACHE_H
+
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+
+namespace metrics {
+
+/// @brief Absolute paths of data nodes, built once per key and kept for later requests, so the
+/// steady state builds no path strings at all. The owner clears it when the set of keys changes
+/// for good, e.g. when the mount table changes. Not thread safe, the owner's lock covers it.
+template <typename Key>
+struct XpathCache {
+
+    /// @param make builds the path of a key that is not cached yet, called with the module name
+    /// @return the path, valid until the cache is cleared or asked for another module
+    template <typename F>
+    char const* get(std::string_view moduleName, Key const& key, F&& make) {
+        if (moduleName != mModuleName) {
+            mPaths.clear();
+            mModuleName = moduleName;
+        }
+        auto itr = mPaths.find(key);
+        if (itr == mPaths.end()) {
+            itr = mPaths.emplace(key, make(moduleName)).first;
+        }
+        return itr->second.c_str();
+    }
+
+    void clear() {
+        mPaths.clear();
+    }
+
+    size_t size() const {
+        return mPaths.size();
+    }
+
+private:
+    std::string mModuleName;
+    std::map<Key, std::string, std::less<>> mPaths;
+};
+
+}  // namespace metrics
+
+#endif  // XPATH_CACHE_H
@@ -0,0 +1,33 @@
+// telekom / sysrepo-plugin-os-metrics
+//
+// This program is made available under the terms of the
+// BSD 3-Clause license which is available at
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// SPDX-FileCopyrightText: 2022 Deutsche Telekom AG
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <iostream>
+
+/// @brief Minimal test assertions, a failed check is reported and the test goes on.
+inline int gCheckFailures(0);
+
+#define CHECK(condition)                                                               \
+    do {                                                                               \
+        if (!(condition)) {                                                            \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #condition \
+                      << std::endl;                                                    \
+            gCheckFailures++;                                                          \
+        }                                                                              \
+    } while (false)
+
+/// @return the exit code of the test
+inline int checkResult() {
+    return gCheckFailures == 0 ? 0 : 1;
+}
+
+#endif  // CHECK_H
@@ -0,0 +1,37 @@
+// telekom / sysrepo-plugin-os-metrics
+//
+// This program is made available under the terms of the
+// BSD 3-Clause license which is available at
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// SPDX-FileCopyrightText: 2022 Deutsche Telekom AG
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include <utils/globals.h>
+
+#include <cmath>
+
+#include "check.h"
+
+int main() {
+    CHECK(formatDecimal(0.0) == "0.00");
+    CHECK(formatDecimal(12.345) == "12.35");
+    CHECK(formatDecimal(-0.001) == "0.00");
+    CHECK(formatDecimal(-0.004) == "0.00");
+    CHECK(formatDecimal(std::nan("")) == "0.00");
+    // load averages are not percentages
+    CHECK(formatDecimal(123.456) == "123.46");
+
+    CHECK(formatPercent(-0.001) == "0.00");
+    CHECK(formatPercent(100.004) == "100.00");
+    CHECK(formatPercent(100.006) == "100.00");
+    CHECK(formatPercent(250.0) == "100.00");
+    CHECK(formatPercent(99.994) == "99.99");
+
+    char buffer[32];
+    CHECK(std::string_view(formatPercent(-0.001, buffer)) == "0.00");
+    CHECK(std::string_view(formatPercent(100.004, buffer)) == "100.00");
+
+    return checkResult();
+}
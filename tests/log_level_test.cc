@@ -0,0 +1,62 @@
+// telekom / sysrepo-plugin-os-metrics
+//
+// This program is made available under the terms of the
+// BSD 3-Clause license which is available at
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// SPDX-FileCopyrightText: 2022 Deutsche Telekom AG
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include <utils/globals.h>
+
+#include <string>
+#include <vector>
+
+#include "check.h"
+
+namespace {
+
+std::vector<std::string> gMessages;
+
+void logCallback(sr_log_level_t /* level */, char const* message) {
+    gMessages.emplace_back(message);
+}
+
+/// @return whether a debug message reached the log callback
+bool debugLogged() {
+    gMessages.clear();
+    logMessage(SR_LL_DBG, "debug message ", 1);
+    return !gMessages.empty() && gMessages.back().find("debug message 1") != std::string::npos;
+}
+
+}  // namespace
+
+int main() {
+    // a host that only logs through a callback, as it is set up with sr_log_set_cb()
+    sr_log_stderr(SR_LL_NONE);
+    sr_log_set_cb(logCallback);
+
+    // without the leaf, debug messages follow the stderr and syslog outputs
+    setLogLevel(std::nullopt);
+    CHECK(!debugLogged());
+    gMessages.clear();
+    logMessage(SR_LL_ERR, "error message");
+    CHECK(gMessages.size() == 1);
+
+    // the leaf set to debug passes them on, whatever the outputs show
+    setLogLevel(SR_LL_DBG);
+    CHECK(debugLogged());
+    sr_log_stderr(SR_LL_WRN);
+    CHECK(debugLogged());
+
+    // and a less detailed level drops them even if stderr shows debug messages
+    sr_log_stderr(SR_LL_DBG);
+    setLogLevel(SR_LL_INF);
+    CHECK(!debugLogged());
+
+    setLogLevel(std::nullopt);
+    CHECK(debugLogged());
+
+    return checkResult();
+}
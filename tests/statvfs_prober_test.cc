@@ -0,0 +1,88 @@
+// telekom / sysrepo-plugin-os-metrics
+//
+// This program is made available under the terms of the
+// BSD 3-Clause license which is available at
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// SPDX-FileCopyrightText: 2022 Deutsche Telekom AG
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include <statvfs_prober.h>
+
+#include <condition_variable>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+
+#include "check.h"
+
+namespace {
+
+std::mutex gHangMtx;
+std::condition_variable gHangCV;
+bool gReleased(false);
+
+/// @brief statvfs stand-in, mount points under /hang block like a dead NFS server until they
+/// are released.
+int fakeStatvfs(char const* path, struct statvfs* buf) {
+    if (std::strncmp(path, "/hang", 5) == 0) {
+        std::unique_lock lk(gHangMtx);
+        gHangCV.wait(lk, [] { return gReleased; });
+    }
+    std::memset(buf, 0, sizeof(*buf));
+    buf->f_blocks = 100;
+    return 0;
+}
+
+void release() {
+    {
+        std::lock_guard lk(gHangMtx);
+        gReleased = true;
+    }
+    gHangCV.notify_all();
+}
+
+}  // namespace
+
+int main() {
+    using metrics::StatvfsProber;
+    using Status = StatvfsProber::Status;
+    constexpr std::chrono::milliseconds kDeadline(300);
+
+    StatvfsProber prober(fakeStatvfs);
+
+    // more hung mounts than idle workers are kept, the healthy one is queued last
+    std::vector<std::string> mountPoints;
+    for (size_t i = 0; i < StatvfsProber::kMaxWorkers + 4; i++) {
+        mountPoints.push_back("/hang" + std::to_string(i));
+    }
+    mountPoints.push_back("/healthy");
+    auto results(prober.probe(mountPoints, kDeadline));
+    CHECK(results.back().status == Status::Ok);
+    CHECK(results.back().buf.f_blocks == 100);
+    for (size_t i = 0; i + 1 < results.size(); i++) {
+        CHECK(results[i].status == Status::TimedOut);
+    }
+
+    // the hung workers do not hold up later probes either
+    results = prober.probe({"/hang0", "/healthy", "/other"}, kDeadline);
+    CHECK(results[0].status == Status::TimedOut);
+    CHECK(results[1].status == Status::Ok);
+    CHECK(results[2].status == Status::Ok);
+
+    // a mount probed again right after it answered is not reported as still pending
+    size_t ok(0);
+    for (size_t i = 0; i < 1000; i++) {
+        ok += prober.probe({"/healthy"}, kDeadline).front().status == Status::Ok;
+    }
+    CHECK(ok == 1000);
+
+    // released mounts answer again
+    release();
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    results = prober.probe({"/hang0"}, kDeadline);
+    CHECK(results[0].status == Status::Ok);
+
+    return checkResult();
+}